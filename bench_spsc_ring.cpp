@@ -0,0 +1,123 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include "spsc_ring.h"
+
+using namespace std;
+
+// Producer/consumer throughput and latency of the old SharedRingBuffer layout (adjacent
+// head/tail, % RING_SIZE, one head and one tail store per event) against SpscRing, whose
+// producer claims and commits a span of up to N events at a time and whose consumer reads
+// and releases whatever is published. Every event carries the producer's steady_clock
+// stamp, taken as it is written; the consumer measures the delay.
+
+using Clock = chrono::steady_clock;
+
+struct BenchEvent {
+    uint64_t tick_number;
+    uint64_t timestamp_ns;
+};
+
+constexpr size_t LEGACY_RING_SIZE = 3 * (1 << 16);
+
+struct LegacyRing {
+    atomic<uint64_t> head;
+    atomic<uint64_t> tail;
+    char padding[64];
+    BenchEvent events[LEGACY_RING_SIZE];
+};
+
+using NewRing = SpscRing<BenchEvent, (1 << 18)>;
+
+struct Result {
+    uint64_t received = 0;
+    uint64_t latency_sum_ns = 0;
+    uint64_t latency_max_ns = 0;
+};
+
+inline uint64_t now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+inline void record(Result& r, const BenchEvent& e) {
+    uint64_t lat = now_ns() - e.timestamp_ns;
+    r.latency_sum_ns += lat;
+    if (lat > r.latency_max_ns) r.latency_max_ns = lat;
+    r.received++;
+}
+
+void report(const string& name, uint64_t events, const Result& r, Clock::duration elapsed) {
+    double seconds = chrono::duration<double>(elapsed).count();
+    cout << left << setw(14) << name << right << fixed
+         << setw(14) << setprecision(0) << (events / seconds) << " events/sec"
+         << setw(12) << setprecision(1) << (r.received ? (double)r.latency_sum_ns / r.received : 0.0) << " ns avg latency"
+         << setw(12) << r.latency_max_ns << " ns max\n";
+}
+
+void bench_legacy(uint64_t events) {
+    auto ring = make_unique<LegacyRing>();
+    ring->head.store(0);
+    ring->tail.store(0);
+    Result r;
+
+    auto start = Clock::now();
+    thread consumer([&] {
+        uint64_t tail = 0;
+        while (r.received < events) {
+            uint64_t head = ring->head.load(memory_order_acquire);
+            while (tail != head) {
+                record(r, ring->events[tail]);
+                tail = (tail + 1) % LEGACY_RING_SIZE;
+                ring->tail.store(tail, memory_order_release);
+            }
+        }
+    });
+    for (uint64_t i = 0; i < events;) {
+        uint64_t head = ring->head.load(memory_order_relaxed);
+        if ((head + 1) % LEGACY_RING_SIZE == ring->tail.load(memory_order_acquire)) continue;
+        ring->events[head] = BenchEvent{i, now_ns()};
+        ring->head.store((head + 1) % LEGACY_RING_SIZE, memory_order_release);
+        i++;
+    }
+    consumer.join();
+    report("legacy", events, r, Clock::now() - start);
+}
+
+void bench_spsc(uint64_t events, size_t batch) {
+    auto ring = make_unique<NewRing>();
+    ring->reset();
+    Result r;
+
+    auto start = Clock::now();
+    thread consumer([&] {
+        while (r.received < events) {
+            auto span = ring->read();
+            for (size_t i = 0; i < span.count; i++) record(r, span.data[i]);
+            if (span.count) ring->release(span.count);
+        }
+    });
+    for (uint64_t i = 0; i < events;) {
+        auto slot = ring->claim(static_cast<size_t>(min<uint64_t>(batch, events - i)));
+        if (!slot.count) continue;
+        for (size_t k = 0; k < slot.count; k++) slot.data[k] = BenchEvent{i + k, now_ns()};
+        ring->commit(slot.count);
+        i += slot.count;
+    }
+    consumer.join();
+    report("SpscRing x" + to_string(batch), events, r, Clock::now() - start);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t events = argc > 1 ? stoull(argv[1]) : 50'000'000;
+
+    cout << "Events: " << events << "\n\n";
+    bench_legacy(events);
+    for (size_t batch : {1, 8, 32, 64, 256}) bench_spsc(events, batch);
+    return 0;
+}
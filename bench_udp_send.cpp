@@ -0,0 +1,93 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "udp_batch.h"
+
+using namespace std;
+
+// Compares the per-jiffy sendto() path of clk_emitter with UdpBatchSender at several batch sizes.
+// Datagrams go to a bound but unread loopback socket, so only the sender side is measured.
+
+constexpr size_t RECORD_SIZE = 88;
+
+void printUsage(const char* program_name) {
+    cout << "Usage: " << program_name << " [datagrams] [records_per_datagram]\n";
+    cout << "Example: " << program_name << " 2000000 2\n";
+}
+
+void report(const string& name, uint64_t datagrams, uint64_t syscalls, chrono::steady_clock::duration elapsed) {
+    double seconds = chrono::duration<double>(elapsed).count();
+    cout << left << setw(20) << name << right
+         << setw(14) << fixed << setprecision(0) << (datagrams / seconds) << " datagrams/sec"
+         << setw(10) << setprecision(1) << (seconds * 1e9 / datagrams) << " ns/datagram"
+         << setw(12) << syscalls << " syscalls\n";
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc > 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    uint64_t datagrams = argc > 1 ? stoull(argv[1]) : 2000000;
+    size_t records = argc > 2 ? stoul(argv[2]) : 2;
+
+    int rx = socket(AF_INET, SOCK_DGRAM, 0);
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    if (rx < 0 || tx < 0) {
+        perror("Socket creation failed");
+        return 1;
+    }
+
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = 0;
+    inet_pton(AF_INET, "127.0.0.1", &dest.sin_addr);
+    socklen_t len = sizeof(dest);
+    if (bind(rx, (sockaddr*)&dest, sizeof(dest)) < 0 || getsockname(rx, (sockaddr*)&dest, &len) < 0) {
+        perror("bind failed");
+        return 1;
+    }
+
+    // A day's worth of distinct payloads so the batch path can't lean on a single hot buffer
+    vector<char> body(4096 * records * RECORD_SIZE, 'x');
+    auto payload = [&](uint64_t i) { return &body[(i % 4096) * records * RECORD_SIZE]; };
+    size_t payload_size = records * RECORD_SIZE;
+
+    cout << "Datagrams: " << datagrams << ", payload: " << payload_size << " bytes\n\n";
+
+    {
+        uint64_t failed = 0;
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < datagrams; i++) {
+            if (sendto(tx, payload(i), payload_size, 0, (sockaddr*)&dest, sizeof(dest)) <= 0) failed++;
+        }
+        auto elapsed = chrono::steady_clock::now() - start;
+        report("sendto", datagrams - failed, datagrams, elapsed);
+    }
+
+    for (size_t batch : {1, 8, 32, 64, 256}) {
+        UdpBatchSender sender(tx, dest, batch, chrono::microseconds(100));
+        auto start = chrono::steady_clock::now();
+        for (uint64_t i = 0; i < datagrams; i++) {
+            sender.add(payload(i), payload_size);
+        }
+        sender.flush();
+        auto elapsed = chrono::steady_clock::now() - start;
+        report("sendmmsg x" + to_string(batch), sender.stats().datagrams, sender.stats().batches, elapsed);
+    }
+
+    close(tx);
+    close(rx);
+    return 0;
+}
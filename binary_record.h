@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "replay_image.h"
+
+// Compact binary form of the 88-byte ASCII .DAT record:
+//
+//   [0, 22)   leading columns          -> prefix, kept verbatim
+//   [22, 36)  14-digit jiffy           -> jiffy
+//   [36, 38)  separator                -> gap, kept verbatim
+//   [38, 48)  10-char padded symbol    -> symbol_id, interned in the image's symbol table
+//   [48, 88)  four 10-char numerics    -> value[], fixed-point with FIXED_POINT_DECIMALS
+//
+// Consumers read jiffy and symbol without parsing, and format_dat_record() rebuilds the
+// ASCII record for those that still want it. The numeric layout is inferred from the data,
+// so build_replay_image only writes a binary image when every record encodes and formats
+// back to the same 88 bytes.
+
+constexpr size_t DAT_VALUE_OFFSET = 48;
+constexpr size_t DAT_VALUE_WIDTH = 10;
+constexpr size_t DAT_VALUE_COLUMNS = 4;
+constexpr int FIXED_POINT_DECIMALS = 4;
+constexpr int64_t FIXED_POINT_SCALE = 10000;
+
+struct BinaryRecord {
+    uint64_t jiffy;
+    uint32_t symbol_id;
+    uint32_t reserved;
+    int64_t value[DAT_VALUE_COLUMNS];
+    char prefix[DAT_JIFFY_OFFSET];
+    char gap[DAT_SYMBOL_OFFSET - DAT_JIFFY_OFFSET - DAT_JIFFY_DIGITS];
+};
+static_assert(sizeof(BinaryRecord) == BINARY_RECORD_SIZE, "BinaryRecord is part of the replay image format");
+
+struct SymbolName {
+    char name[DAT_SYMBOL_SIZE];
+};
+
+// Interns 10-byte symbol fields into dense ids, in order of first appearance
+class SymbolTable {
+public:
+    uint32_t intern(const char* symbol) {
+        auto it = ids_.find(std::string(symbol, DAT_SYMBOL_SIZE));
+        if (it != ids_.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(names_.size());
+        SymbolName entry;
+        memcpy(entry.name, symbol, DAT_SYMBOL_SIZE);
+        names_.push_back(entry);
+        ids_.emplace(std::string(symbol, DAT_SYMBOL_SIZE), id);
+        return id;
+    }
+
+    const std::vector<SymbolName>& names() const { return names_; }
+
+private:
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::vector<SymbolName> names_;
+};
+
+// Parse a right-aligned decimal column ("  12345", "-12.5", "0000012345") into fixed-point
+inline bool parse_fixed_point(const char* field, size_t width, int64_t& out) {
+    size_t i = 0;
+    while (i < width && field[i] == ' ') i++;
+    bool negative = i < width && field[i] == '-';
+    if (negative || (i < width && field[i] == '+')) i++;
+
+    int64_t value = 0;
+    int decimals = -1;
+    bool digits = false;
+    for (; i < width; i++) {
+        char c = field[i];
+        if (c == '.' && decimals < 0) {
+            decimals = 0;
+        } else if (c >= '0' && c <= '9') {
+            if (decimals >= FIXED_POINT_DECIMALS) return false;
+            value = value * 10 + (c - '0');
+            if (decimals >= 0) decimals++;
+            digits = true;
+        } else {
+            return false;
+        }
+    }
+    if (!digits) return false;
+    for (int d = decimals < 0 ? 0 : decimals; d < FIXED_POINT_DECIMALS; d++) value *= 10;
+    out = negative ? -value : value;
+    return true;
+}
+
+inline bool encode_binary_record(const char* rec, SymbolTable& symbols, BinaryRecord& out) {
+    memset(&out, 0, sizeof(out));
+    if (!parse_record_jiffy(rec, out.jiffy)) return false;
+    for (size_t c = 0; c < DAT_VALUE_COLUMNS; c++) {
+        if (!parse_fixed_point(rec + DAT_VALUE_OFFSET + c * DAT_VALUE_WIDTH, DAT_VALUE_WIDTH, out.value[c])) return false;
+    }
+    out.symbol_id = symbols.intern(rec + DAT_SYMBOL_OFFSET);
+    memcpy(out.prefix, rec, sizeof(out.prefix));
+    memcpy(out.gap, rec + DAT_JIFFY_OFFSET + DAT_JIFFY_DIGITS, sizeof(out.gap));
+    return true;
+}
+
+// Rebuild the ASCII record; numerics come back zero-padded and without a decimal point
+// unless they carry a fraction
+inline void format_dat_record(const BinaryRecord& rec, const SymbolName* symbols, char* out) {
+    memcpy(out, rec.prefix, sizeof(rec.prefix));
+
+    uint64_t jiffy = rec.jiffy;
+    for (size_t i = DAT_JIFFY_DIGITS; i-- > 0; jiffy /= 10) out[DAT_JIFFY_OFFSET + i] = char('0' + jiffy % 10);
+
+    memcpy(out + DAT_JIFFY_OFFSET + DAT_JIFFY_DIGITS, rec.gap, sizeof(rec.gap));
+    memcpy(out + DAT_SYMBOL_OFFSET, symbols[rec.symbol_id].name, DAT_SYMBOL_SIZE);
+
+    for (size_t c = 0; c < DAT_VALUE_COLUMNS; c++) {
+        char* field = out + DAT_VALUE_OFFSET + c * DAT_VALUE_WIDTH;
+        int64_t v = rec.value[c];
+        bool negative = v < 0;
+        uint64_t mag = negative ? -static_cast<uint64_t>(v) : static_cast<uint64_t>(v);
+        uint64_t whole = mag / FIXED_POINT_SCALE;
+        uint64_t frac = mag % FIXED_POINT_SCALE;
+
+        char digits[32];
+        size_t n = 0;
+        if (frac) {
+            int decimals = FIXED_POINT_DECIMALS;
+            while (frac % 10 == 0) { frac /= 10; decimals--; }
+            for (int d = 0; d < decimals; d++, frac /= 10) digits[n++] = char('0' + frac % 10);
+            digits[n++] = '.';
+        }
+        do { digits[n++] = char('0' + whole % 10); whole /= 10; } while (whole);
+        if (negative) digits[n++] = '-';
+
+        size_t i = 0;
+        for (; i + n < DAT_VALUE_WIDTH; i++) field[i] = negative ? ' ' : '0';
+        while (n && i < DAT_VALUE_WIDTH) field[i++] = digits[--n];
+    }
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define BLOCK_READER_IO_URING 1
+#endif
+
+// Sequential reader for files too large to load, in big page-aligned blocks. With io_uring,
+// QUEUE_DEPTH block reads stay in flight ahead of the caller, so the disk is busy while the
+// previous block is parsed. The ring is driven through the raw syscalls, not liburing. If the
+// kernel headers lack io_uring, or io_uring_setup() is refused at run time, the same blocks
+// are read with ifstream. Memory use is QUEUE_DEPTH blocks, whatever the file size.
+class BlockReader {
+public:
+    static constexpr size_t BLOCK_BYTES = 1 << 20;
+    static constexpr unsigned QUEUE_DEPTH = 4;
+
+    BlockReader() = default;
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+    ~BlockReader() { close(); }
+
+    // Read bytes [begin, end) of the file, clipped to its size
+    bool open(const std::string& path, std::string& error, uint64_t begin = 0, uint64_t end = UINT64_MAX) {
+        close();
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            error = "unable to open " + path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) < 0) {
+            error = "unable to stat " + path + ": " + strerror(errno);
+            return false;
+        }
+        end = std::min<uint64_t>(end, static_cast<uint64_t>(st.st_size));
+        base_ = std::min(begin, end);
+        size_ = end - base_;
+        block_count_ = (size_ + BLOCK_BYTES - 1) / BLOCK_BYTES;
+        posix_fadvise(fd_, static_cast<off_t>(base_), static_cast<off_t>(size_), POSIX_FADV_SEQUENTIAL);
+
+        for (auto& buf : buffers_) {
+            void* p = nullptr;
+            if (posix_memalign(&p, 4096, BLOCK_BYTES) != 0) {
+                error = "out of memory for read blocks";
+                return false;
+            }
+            buf = static_cast<char*>(p);
+        }
+
+#ifdef BLOCK_READER_IO_URING
+        uring_ = setup_ring();
+        for (uint64_t b = 0; uring_ && b < std::min<uint64_t>(QUEUE_DEPTH, block_count_); b++) {
+            submit(b);
+        }
+#endif
+        if (!uring_) {
+            file_.open(path, std::ios::binary);
+            file_.seekg(static_cast<std::streamoff>(base_));
+            if (!file_) {
+                error = "unable to open " + path;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Next block in file order, or 0 at end of file or on a read error. The block stays valid
+    // until the following call.
+    size_t next(const char*& data) {
+        if (next_block_ >= block_count_) return 0;
+        size_t slot = next_block_ % QUEUE_DEPTH;
+        size_t want = expected(next_block_);
+        size_t got = 0;
+
+#ifdef BLOCK_READER_IO_URING
+        if (uring_) {
+            // The slot of the block handed out last time is free again: start reading ahead into it
+            if (next_block_ > 0 && next_block_ - 1 + QUEUE_DEPTH < block_count_) {
+                submit(next_block_ - 1 + QUEUE_DEPTH);
+            }
+            while (!done_[slot]) reap();
+            done_[slot] = false;
+            got = result_[slot] > 0 ? static_cast<size_t>(result_[slot]) : 0;
+            // Short or failed reads are finished synchronously
+            while (got < want) {
+                ssize_t n = pread(fd_, buffers_[slot] + got, want - got, base_ + next_block_ * BLOCK_BYTES + got);
+                if (n <= 0) break;
+                got += static_cast<size_t>(n);
+            }
+        }
+#endif
+        if (!uring_) {
+            file_.read(buffers_[slot], static_cast<std::streamsize>(want));
+            got = static_cast<size_t>(file_.gcount());
+        }
+
+        if (got < want) {
+            block_count_ = next_block_;     // read error: stop here
+            return 0;
+        }
+        next_block_++;
+        bytes_read_ += got;
+        data = buffers_[slot];
+        return got;
+    }
+
+    bool using_io_uring() const { return uring_; }
+    uint64_t size() const { return size_; }         // bytes in the range being read
+    uint64_t bytes_read() const { return bytes_read_; }
+
+    void close() {
+#ifdef BLOCK_READER_IO_URING
+        if (uring_) {
+            // Let in-flight reads land before their buffers go away
+            while (in_flight_) reap();
+            if (sqes_) munmap(sqes_, sqes_size_);
+            if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+            if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+            ::close(ring_fd_);
+            sq_ring_ = cq_ring_ = nullptr;
+            sqes_ = nullptr;
+            in_flight_ = 0;
+            for (auto& d : done_) d = false;
+        }
+#endif
+        uring_ = false;
+        if (file_.is_open()) file_.close();
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        for (auto& buf : buffers_) {
+            free(buf);
+            buf = nullptr;
+        }
+        base_ = size_ = block_count_ = next_block_ = bytes_read_ = 0;
+    }
+
+private:
+    size_t expected(uint64_t block) const {
+        return static_cast<size_t>(std::min<uint64_t>(BLOCK_BYTES, size_ - block * BLOCK_BYTES));
+    }
+
+#ifdef BLOCK_READER_IO_URING
+    bool setup_ring() {
+        io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &p));
+        if (fd < 0) return false;
+
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        void* sq = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        void* cq = single ? sq : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) munmap(sqes, sqes_size_);
+            if (cq != MAP_FAILED && cq != sq) munmap(cq, cq_ring_size_);
+            if (sq != MAP_FAILED) munmap(sq, sq_ring_size_);
+            ::close(fd);
+            return false;
+        }
+
+        ring_fd_ = fd;
+        sq_ring_ = static_cast<char*>(sq);
+        cq_ring_ = static_cast<char*>(cq);
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq_ring_ + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq_ring_ + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring_ + p.cq_off.cqes);
+        return true;
+    }
+
+    void submit(uint64_t block) {
+        unsigned tail = *sq_tail_;
+        unsigned idx = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[idx];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<uint64_t>(buffers_[block % QUEUE_DEPTH]);
+        sqe.len = static_cast<uint32_t>(expected(block));
+        sqe.off = base_ + block * BLOCK_BYTES;
+        sqe.user_data = block;
+        sq_array_[idx] = idx;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+        in_flight_++;
+    }
+
+    // Wait for at least one completion and record every completion available
+    void reap() {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        }
+        for (; head != tail; head++) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            size_t slot = cqe.user_data % QUEUE_DEPTH;
+            result_[slot] = cqe.res;
+            done_[slot] = true;
+            in_flight_--;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    int ring_fd_ = -1;
+    char* sq_ring_ = nullptr;
+    char* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    int32_t result_[QUEUE_DEPTH] = {};
+    bool done_[QUEUE_DEPTH] = {};
+    unsigned in_flight_ = 0;
+#endif
+
+    int fd_ = -1;
+    bool uring_ = false;
+    std::ifstream file_;
+    char* buffers_[QUEUE_DEPTH] = {};
+    uint64_t base_ = 0;
+    uint64_t size_ = 0;
+    uint64_t block_count_ = 0;
+    uint64_t next_block_ = 0;
+    uint64_t bytes_read_ = 0;
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer multi-consumer broadcast ring for shared memory. The producer writes
+// each slot once and every registered consumer reads it through its own cursor. Free
+// space is bounded by the slowest active cursor, which the producer caches and only
+// recomputes when the cached value says the ring is full.
+//
+// Consumers may register at any time, before or while the producer publishes, and join at
+// the current head. A joining cursor gates the producer from the moment it claims its slot:
+// the claim and the producer's min-tail refresh are ordered (seq_cst claim and head load on
+// one side, a seq_cst fence before the cursor scan on the other), so either the refresh sees
+// the joining cursor, or the cursor reads a head no lower than the one the refresh bounded
+// against. Until its tail is written, a joining cursor is taken to be a full ring behind.
+// A gating cursor holds the producer back when it is a full ring behind; a non-gating one
+// never does, and is lapped instead. Non-gating readers copy slots out with at() and then
+// check published() to find which copies the producer may have overwritten meanwhile.
+template <typename T, size_t Capacity, size_t MaxConsumers>
+struct BroadcastRing {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "BroadcastRing capacity must be a power of 2");
+    static constexpr size_t MASK = Capacity - 1;
+
+    enum CursorState : uint32_t { CURSOR_FREE = 0, CURSOR_JOINING = 1, CURSOR_ACTIVE = 2 };
+
+    struct Span {
+        T* data;
+        size_t count;
+    };
+
+    struct alignas(64) Cursor {
+        std::atomic<uint64_t> tail;
+        std::atomic<uint32_t> state;
+        std::atomic<uint32_t> gating;
+        uint64_t cached_head;
+    };
+
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> head;
+    uint64_t cached_min_tail;
+
+    Cursor cursors[MaxConsumers];
+
+    alignas(64) T slots[Capacity];
+
+    // Every cursor free, head at 0; slots are left as they are, none is read before it is written
+    BroadcastRing() {
+        for (auto& c : cursors) {
+            c.state.store(CURSOR_FREE, std::memory_order_relaxed);
+            c.gating.store(0, std::memory_order_relaxed);
+        }
+        reset();
+    }
+
+    // Producer: restart at 0 for a new session, keeping registrations; only safe while
+    // no consumer is reading or joining
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        cached_min_tail = 0;
+        for (auto& c : cursors) {
+            c.tail.store(0, std::memory_order_relaxed);
+            c.cached_head = 0;
+        }
+    }
+
+    // Consumer: take a free cursor; returns -1 when all MaxConsumers are taken. on_join(id)
+    // runs before the cursor is active, to set up per-consumer state; the producer already
+    // treats it as a blocking cursor a full ring behind by then.
+    template <typename OnJoin>
+    int register_consumer(bool gating, OnJoin on_join) {
+        for (size_t i = 0; i < MaxConsumers; i++) {
+            uint32_t expected = CURSOR_FREE;
+            if (cursors[i].state.compare_exchange_strong(expected, CURSOR_JOINING, std::memory_order_seq_cst)) {
+                uint64_t h = head.load(std::memory_order_seq_cst);
+                cursors[i].tail.store(h, std::memory_order_relaxed);
+                cursors[i].gating.store(gating, std::memory_order_relaxed);
+                cursors[i].cached_head = h;
+                on_join(i);
+                cursors[i].state.store(CURSOR_ACTIVE, std::memory_order_release);
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    int register_consumer(bool gating = true) {
+        return register_consumer(gating, [](size_t) {});
+    }
+
+    void unregister_consumer(int id) {
+        cursors[id].state.store(CURSOR_FREE, std::memory_order_release);
+    }
+
+    bool active(size_t id) const {
+        return cursors[id].state.load(std::memory_order_acquire) == CURSOR_ACTIVE;
+    }
+
+    bool joining(size_t id) const {
+        return cursors[id].state.load(std::memory_order_acquire) == CURSOR_JOINING;
+    }
+
+    // Producer: true once the cursor has released everything published so far
+    bool caught_up(size_t id) const {
+        return cursors[id].tail.load(std::memory_order_acquire) == head.load(std::memory_order_relaxed);
+    }
+
+    bool gating(size_t id) const {
+        return cursors[id].gating.load(std::memory_order_relaxed);
+    }
+
+    // Producer: true for cursors that bound how far it may publish: active gating ones and
+    // any that are still joining, whatever their policy
+    bool holds_back(size_t id) const {
+        uint32_t state = cursors[id].state.load(std::memory_order_acquire);
+        return state == CURSOR_JOINING || (state == CURSOR_ACTIVE && gating(id));
+    }
+
+    // Producer: a cursor's tail as far as bounding the producer goes. A joining cursor may
+    // still hold a stale tail from an earlier registration, so it counts as a full ring
+    // behind `head` at most.
+    uint64_t bounding_tail(size_t id, uint64_t h) const {
+        uint64_t t = cursors[id].tail.load(std::memory_order_acquire);
+        if (cursors[id].state.load(std::memory_order_acquire) == CURSOR_JOINING) {
+            t = std::max(t, h > Capacity ? h - Capacity : 0);
+        }
+        return t;
+    }
+
+    size_t active_consumers() const {
+        size_t n = 0;
+        for (size_t i = 0; i < MaxConsumers; i++) n += active(i);
+        return n;
+    }
+
+    // Producer: tail of the slowest consumer holding it back (head when there is none). The
+    // fence pairs with register_consumer, so a cursor that joins meanwhile is either seen
+    // here or starts at a head no lower than `h`.
+    uint64_t min_tail() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t slowest = h;
+        for (size_t i = 0; i < MaxConsumers; i++) {
+            if (holds_back(i)) slowest = std::min(slowest, bounding_tail(i, h));
+        }
+        return slowest;
+    }
+
+    // Producer: up to `want` free slots; count is 0 when the slowest consumer is a full ring behind
+    Span claim(size_t want = 1) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (Capacity - (h - cached_min_tail) < want) {
+            cached_min_tail = min_tail();
+        }
+        size_t free = Capacity - (h - cached_min_tail);
+        size_t n = std::min(std::min(want, free), Capacity - (h & MASK));
+        return Span{&slots[h & MASK], n};
+    }
+
+    // The fence keeps the next claim's slot writes behind the new head, so a non-gating
+    // reader that sees an overwritten slot also sees the head that lapped it
+    void commit(size_t n = 1) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    uint64_t published() const {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Consumer: up to `max` slots published since this cursor's tail
+    Span read(int id, size_t max = Capacity) {
+        Cursor& c = cursors[id];
+        uint64_t t = c.tail.load(std::memory_order_relaxed);
+        if (c.cached_head == t) {
+            c.cached_head = head.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(std::min(max, static_cast<size_t>(c.cached_head - t)), Capacity - (t & MASK));
+        return Span{&slots[t & MASK], n};
+    }
+
+    void release(int id, size_t n) {
+        Cursor& c = cursors[id];
+        c.tail.store(c.tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Consumer, non-gating: raw access by position, validated by the caller
+    uint64_t tail(int id) const {
+        return cursors[id].tail.load(std::memory_order_relaxed);
+    }
+
+    const T& at(uint64_t pos) const {
+        return slots[pos & MASK];
+    }
+
+    void seek(int id, uint64_t pos) {
+        cursors[id].tail.store(pos, std::memory_order_release);
+    }
+};
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+
+#include "replay_image.h"
+#include "binary_record.h"
+
+using namespace std;
+
+// Offline step: turn a sorted 88-byte .DAT file into a replay image that clk_emitter can mmap.
+// Records are streamed straight into the image body; only the jiffy index and the symbol
+// table are kept in memory. With --binary the records are converted to BinaryRecord; the
+// conversion fails on the first record that does not encode, or does not decode back to the
+// same 88 bytes, so a binary image always replays exactly what the .DAT file holds.
+
+void printUsage(const char* program_name) {
+    cout << "Usage: " << program_name << " <input.DAT> <output.img> [--binary]\n";
+    cout << "Example: " << program_name << " Data/sorted_filtered_data5.DAT Data/sorted_filtered_data5.img --binary\n";
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 3 && !(argc == 4 && string(argv[3]) == "--binary")) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const string input = argv[1];
+    const string output = argv[2];
+    const bool binary = argc == 4;
+
+    ifstream in(input, ios::binary);
+    if (!in) {
+        cerr << "Failed to open " << input << "\n";
+        return 1;
+    }
+
+    ofstream out(output, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Failed to create " << output << "\n";
+        return 1;
+    }
+
+    auto start_time = chrono::high_resolution_clock::now();
+
+    ReplayImageHeader hdr{};
+    hdr.magic = REPLAY_IMAGE_MAGIC;
+    hdr.version = REPLAY_IMAGE_VERSION;
+    hdr.record_size = binary ? sizeof(BinaryRecord) : DAT_RECORD_SIZE;
+    hdr.record_format = binary ? RECORD_FORMAT_BINARY : RECORD_FORMAT_DAT;
+    hdr.body_offset = sizeof(ReplayImageHeader);
+
+    // Placeholder header, rewritten once the counts are known
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+    vector<JiffyIndexEntry> index;
+    vector<char> block(DAT_RECORD_SIZE * 4096);
+    uint64_t record_count = 0;
+    uint64_t bad_records = 0;
+    SymbolTable symbols;
+    BinaryRecord bin;
+    char check[DAT_RECORD_SIZE];
+
+    while (in) {
+        in.read(block.data(), block.size());
+        size_t got = static_cast<size_t>(in.gcount()) / DAT_RECORD_SIZE;
+
+        for (size_t r = 0; r < got; r++) {
+            const char* rec = block.data() + r * DAT_RECORD_SIZE;
+            uint64_t jiffi;
+            if (binary) {
+                // Nothing may be dropped or altered on the way to the binary layout
+                bool exact = encode_binary_record(rec, symbols, bin);
+                if (exact) {
+                    format_dat_record(bin, symbols.names().data(), check);
+                    exact = memcmp(check, rec, DAT_RECORD_SIZE) == 0;
+                }
+                if (!exact) {
+                    cerr << "Error: record " << (record_count + bad_records) << " of " << input
+                         << " does not convert to a byte-exact binary record:\n  "
+                         << string(rec, DAT_RECORD_SIZE) << "\n"
+                         << "Build an ASCII image instead (without --binary)\n";
+                    out.close();
+                    remove(output.c_str());
+                    return 1;
+                }
+                jiffi = bin.jiffy;
+            } else if (!parse_record_jiffy(rec, jiffi)) {
+                bad_records++;
+                continue;
+            }
+
+            if (index.empty() || index.back().jiffy != jiffi) {
+                if (!index.empty() && jiffi < index.back().jiffy) {
+                    cerr << "Error: " << input << " is not sorted by jiffy (record "
+                         << record_count << ": " << jiffi << " after " << index.back().jiffy << ")\n";
+                    out.close();
+                    remove(output.c_str());
+                    return 1;
+                }
+                index.push_back(JiffyIndexEntry{jiffi, record_count, 0, 0});
+            }
+
+            if (binary) {
+                out.write(reinterpret_cast<const char*>(&bin), sizeof(bin));
+            } else {
+                out.write(rec, DAT_RECORD_SIZE);
+            }
+            index.back().record_count++;
+            record_count++;
+        }
+    }
+
+    hdr.jiffy_count = index.size();
+    hdr.record_count = record_count;
+    hdr.index_offset = hdr.body_offset + record_count * hdr.record_size;
+    hdr.symbol_count = static_cast<uint32_t>(symbols.names().size());
+    hdr.symbol_offset = hdr.index_offset + index.size() * sizeof(JiffyIndexEntry);
+
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(JiffyIndexEntry));
+    out.write(reinterpret_cast<const char*>(symbols.names().data()), symbols.names().size() * sizeof(SymbolName));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.close();
+
+    if (!out) {
+        cerr << "Failed to write " << output << "\n";
+        return 1;
+    }
+
+    auto end_time = chrono::high_resolution_clock::now();
+    auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
+
+    cout << "Replay image written: " << output << "\n";
+    cout << "Records:                 " << record_count << "\n";
+    cout << "Populated jiffies:       " << index.size() << "\n";
+    cout << "Skipped bad records:     " << bad_records << "\n";
+    if (binary) {
+        cout << "Record format:           binary (" << sizeof(BinaryRecord) << " bytes)\n";
+        cout << "Symbols:                 " << symbols.names().size() << "\n";
+    }
+    cout << "Elapsed Time:            " << elapsed_ms / 1000.0 << " sec\n";
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+// Proleptic Gregorian calendar arithmetic in plain integers (Howard Hinnant's days_from_civil
+// and civil_from_days). Everything is constexpr and never touches mktime/localtime, so there is
+// no global tz lock, no dependence on the host's TZ or DST rules, and it is safe from any thread.
+//
+// Jiffies count 1/65536 s of exchange wall-clock time since 1980-01-01 00:00 at the exchange.
+// The exchange keeps a fixed UTC offset with no DST, so a wall-clock difference is an exact
+// elapsed time; the offset only matters when converting to or from Unix time.
+
+constexpr int64_t SECONDS_PER_DAY = 24 * 3600;
+constexpr int64_t EXCHANGE_UTC_OFFSET_SEC = 5 * 3600 + 30 * 60;     // NSE, IST (UTC+05:30)
+constexpr unsigned JIFFY_SHIFT = 16;                                // 65,536 jiffies/sec
+
+struct CivilDate {
+    int year;
+    unsigned month;     // 1-12
+    unsigned day;       // 1-31
+};
+
+// Days from 1970-01-01 to y-m-d (negative before it)
+constexpr int64_t days_from_civil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);                 // [0, 399]
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;      // [0, 365]
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                // [0, 146096]
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+constexpr CivilDate civil_from_days(int64_t z) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    return CivilDate{static_cast<int>(yoe + era * 400 + (m <= 2)), m, d};
+}
+
+// 0 = Sunday ... 6 = Saturday
+constexpr unsigned weekday_from_days(int64_t z) {
+    return static_cast<unsigned>(z >= -4 ? (z + 4) % 7 : (z + 5) % 7 + 6);
+}
+
+constexpr bool is_leap_year(int y) {
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+constexpr unsigned days_in_month(int y, unsigned m) {
+    return m == 2 ? (is_leap_year(y) ? 29 : 28) : (m == 4 || m == 6 || m == 9 || m == 11) ? 30 : 31;
+}
+
+constexpr bool valid_civil(int y, unsigned m, unsigned d) {
+    return m >= 1 && m <= 12 && d >= 1 && d <= days_in_month(y, m);
+}
+
+constexpr int64_t JIFFY_EPOCH_DAYS = days_from_civil(1980, 1, 1);
+
+// Exchange wall-clock seconds from the jiffy epoch to y-m-d hh:mm:ss
+constexpr int64_t epoch_seconds(int y, unsigned m, unsigned d, int hh = 0, int mm = 0, int ss = 0) {
+    return (days_from_civil(y, m, d) - JIFFY_EPOCH_DAYS) * SECONDS_PER_DAY + hh * 3600 + mm * 60 + ss;
+}
+
+constexpr uint64_t civil_to_jiffies(int y, unsigned m, unsigned d, int hh = 0, int mm = 0, int ss = 0) {
+    return static_cast<uint64_t>(epoch_seconds(y, m, d, hh, mm, ss)) << JIFFY_SHIFT;
+}
+
+// Exchange trading day a jiffy falls on
+constexpr CivilDate civil_from_jiffies(uint64_t jiffies) {
+    return civil_from_days(JIFFY_EPOCH_DAYS + static_cast<int64_t>((jiffies >> JIFFY_SHIFT) / SECONDS_PER_DAY));
+}
+
+// Unix time <-> jiffies, through the exchange's UTC offset
+constexpr int64_t unix_from_jiffies(uint64_t jiffies) {
+    return JIFFY_EPOCH_DAYS * SECONDS_PER_DAY - EXCHANGE_UTC_OFFSET_SEC + static_cast<int64_t>(jiffies >> JIFFY_SHIFT);
+}
+
+constexpr uint64_t jiffies_from_unix(int64_t unix_seconds) {
+    return static_cast<uint64_t>(unix_seconds + EXCHANGE_UTC_OFFSET_SEC - JIFFY_EPOCH_DAYS * SECONDS_PER_DAY) << JIFFY_SHIFT;
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0, "civil_date: Unix epoch");
+static_assert(JIFFY_EPOCH_DAYS == 3652, "civil_date: 1980-01-01");
+static_assert(weekday_from_days(days_from_civil(2024, 9, 2)) == 1, "civil_date: 2024-09-02 is a Monday");
+static_assert(civil_from_days(days_from_civil(2024, 2, 29) + 1).month == 3, "civil_date: leap day rollover");
@@ -5,6 +5,7 @@
 #include <chrono>
 #include <iomanip>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <atomic>
@@ -15,11 +16,28 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include "replay_image.h"
+#include "udp_batch.h"
+#include "jiffy_packet.h"
+#include "binary_record.h"
+#include "symbol_filter.h"
+#include "pacer.h"
+#include "block_reader.h"
+#include "sparse_index.h"
+#include "civil_date.h"
+#include "trading_calendar.h"
+
 using namespace std;
 
 using Clock = chrono::steady_clock;
@@ -35,23 +53,179 @@ string filename = "Data/sorted_filtered_data5.DAT";
 
 // -----------------------------------------------------------------------------------------------------
 
-unordered_map<uint64_t, vector<string>> preprocess_jiffi_map(const string& filename) {
+// In-memory replay image, used when no prebuilt image is given on the command line
+// or when a symbol filter narrows one down
+struct ReplayBuffer {
+    vector<JiffyIndexEntry> index;
+    vector<char> body;
+    size_t record_size = RECORD_SIZE;
+    uint32_t record_format = RECORD_FORMAT_DAT;
+    const char* symbols = nullptr;
+    size_t symbol_count = 0;
+
+    ReplayView view() const {
+        ReplayView v;
+        v.index = index.data();
+        v.jiffy_count = index.size();
+        v.body = body.data();
+        v.record_count = body.size() / record_size;
+        v.record_size = record_size;
+        v.record_format = record_format;
+        v.symbols = symbols;
+        v.symbol_count = symbol_count;
+        return v;
+    }
+};
+
+// Run fn(part, begin, end) on its own thread for each of `parts` contiguous slices of [0, count)
+template <typename Fn>
+void for_each_chunk(size_t count, size_t parts, Fn fn) {
+    vector<thread> threads;
+    for (size_t p = 0; p < parts; p++) {
+        threads.emplace_back(fn, p, count * p / parts, count * (p + 1) / parts);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// Load and index bytes [begin, end) of the .DAT file on all cores: each worker preads and parses its
+// own record-aligned chunk, and unsorted input is grouped by a per-chunk stable sort followed by
+// pairwise merges
+ReplayBuffer preprocess_jiffi_map(const string& filename, uint64_t begin_offset = 0, uint64_t end_offset = UINT64_MAX) {
+    constexpr size_t MIN_CHUNK_RECORDS = 1 << 16;
+
     cout<<"Preprocessing data\n";
-    unordered_map<uint64_t, vector<string>> jiffi_map;
+    ReplayBuffer buffer;
 
-    ifstream file(filename, ios::binary);
-    if (!file) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
         cerr << "Failed to open file.\n";
-        return jiffi_map;
+        if (fd >= 0) close(fd);
+        return buffer;
+    }
+
+    end_offset = min<uint64_t>(end_offset, static_cast<uint64_t>(st.st_size));
+    begin_offset = min(begin_offset, end_offset);
+    size_t total_records = static_cast<size_t>(end_offset - begin_offset) / RECORD_SIZE;
+    size_t workers = max<size_t>(1, min<size_t>(thread::hardware_concurrency(), total_records / MIN_CHUNK_RECORDS));
+    buffer.body.resize(total_records * RECORD_SIZE);
+
+    vector<uint64_t> jiffies(total_records);
+    vector<char> chunk_sorted(workers, 1);
+    vector<char> chunk_read(workers, 1);
+    for_each_chunk(total_records, workers, [&](size_t part, size_t begin, size_t end) {
+        char* dst = &buffer.body[begin * RECORD_SIZE];
+        size_t want = (end - begin) * RECORD_SIZE, got = 0;
+        while (got < want) {
+            ssize_t n = pread(fd, dst + got, want - got, static_cast<off_t>(begin_offset + begin * RECORD_SIZE + got));
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        if (got < want) {
+            chunk_read[part] = 0;
+            return;
+        }
+
+        bool sorted = true;
+        for (size_t r = begin; r < end; r++) {
+            if (!parse_record_jiffy(&buffer.body[r * RECORD_SIZE], jiffies[r])) {
+                jiffies[r] = 0;
+            }
+            sorted = sorted && (r == begin || jiffies[r - 1] <= jiffies[r]);
+        }
+        chunk_sorted[part] = sorted;
+    });
+    close(fd);
+
+    if (find(chunk_read.begin(), chunk_read.end(), 0) != chunk_read.end()) {
+        cerr << "Failed to read file.\n";
+        return ReplayBuffer();
+    }
+
+    bool sorted = find(chunk_sorted.begin(), chunk_sorted.end(), 0) == chunk_sorted.end();
+    for (size_t p = 1; p < workers && sorted; p++) {
+        size_t first = total_records * p / workers;
+        sorted = jiffies[first - 1] <= jiffies[first];
+    }
+
+    // Unsorted input: group records by jiffy, keeping file order within a jiffy
+    if (!sorted) {
+        auto by_jiffy = [&](size_t a, size_t b) { return jiffies[a] < jiffies[b]; };
+        vector<size_t> order(total_records);
+        for (size_t r = 0; r < total_records; r++) order[r] = r;
+
+        for_each_chunk(total_records, workers, [&](size_t, size_t begin, size_t end) {
+            stable_sort(order.begin() + begin, order.begin() + end, by_jiffy);
+        });
+
+        // Merging neighbours keeps the earlier chunk first among equal jiffies, so the result is stable
+        vector<size_t> bounds;
+        for (size_t p = 0; p <= workers; p++) bounds.push_back(total_records * p / workers);
+        while (bounds.size() > 2) {
+            size_t pairs = (bounds.size() - 1) / 2;
+            for_each_chunk(pairs, pairs, [&](size_t pair, size_t, size_t) {
+                inplace_merge(order.begin() + bounds[2 * pair], order.begin() + bounds[2 * pair + 1],
+                              order.begin() + bounds[2 * pair + 2], by_jiffy);
+            });
+            vector<size_t> merged;
+            for (size_t i = 0; i < bounds.size(); i += 2) merged.push_back(bounds[i]);
+            if (merged.back() != total_records) merged.push_back(total_records);
+            bounds.swap(merged);
+        }
+
+        vector<char> grouped(buffer.body.size());
+        vector<uint64_t> grouped_jiffies(total_records);
+        for_each_chunk(total_records, workers, [&](size_t, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++) {
+                memcpy(&grouped[r * RECORD_SIZE], &buffer.body[order[r] * RECORD_SIZE], RECORD_SIZE);
+                grouped_jiffies[r] = jiffies[order[r]];
+            }
+        });
+        buffer.body.swap(grouped);
+        jiffies.swap(grouped_jiffies);
+    }
+
+    for (size_t r = 0; r < total_records; r++) {
+        if (buffer.index.empty() || buffer.index.back().jiffy != jiffies[r]) {
+            buffer.index.push_back(JiffyIndexEntry{jiffies[r], r, 0, 0});
+        }
+        buffer.index.back().record_count++;
+    }
+    return buffer;
+}
+
+// Keep only the records of subscribed symbols, once at load time, so replay never sees the rest
+ReplayBuffer filter_jiffi_records(const ReplayView& src, const SymbolFilter& filter) {
+    ReplayBuffer out;
+    out.record_size = src.record_size;
+    out.record_format = src.record_format;
+    out.symbols = src.symbols;
+    out.symbol_count = src.symbol_count;
+
+    // Binary records carry an interned id, so each symbol is matched once instead of per record
+    bool binary = src.record_format == RECORD_FORMAT_BINARY;
+    vector<char> keep_id(binary ? src.symbol_count : 0);
+    for (size_t id = 0; id < keep_id.size(); id++) {
+        keep_id[id] = filter.matches(src.symbols + id * DAT_SYMBOL_SIZE);
     }
 
-    string line(RECORD_SIZE, '\0');
+    for (const JiffyIndexEntry& e : src) {
+        const char* rec = src.records(e);
+        for (uint32_t r = 0; r < e.record_count; r++, rec += src.record_size) {
+            bool keep = binary ? keep_id[reinterpret_cast<const BinaryRecord*>(rec)->symbol_id]
+                               : filter.matches(rec + DAT_SYMBOL_OFFSET);
+            if (!keep) continue;
 
-    while (file.read(&line[0], RECORD_SIZE)) {
-        uint64_t jiffi = stoull(line.substr(22, 14));  // Extract jiffi
-        jiffi_map[jiffi].push_back(line);         // Group lines by jiffi
+            if (out.index.empty() || out.index.back().jiffy != e.jiffy) {
+                out.index.push_back(JiffyIndexEntry{e.jiffy, out.body.size() / out.record_size, 0, 0});
+            }
+            out.body.insert(out.body.end(), rec, rec + src.record_size);
+            out.index.back().record_count++;
+        }
     }
-    return jiffi_map;
+    return out;
 }
 
 // -----------------------------------------------------------------------------------------------------
@@ -79,16 +253,8 @@ struct Date {
     }
 
     Date addDays(int days) const {
-        struct tm tm = {};
-        tm.tm_year = year - 1900;
-        tm.tm_mon = month - 1;
-        tm.tm_mday = day + days;
-        tm.tm_hour = hour;
-        tm.tm_min = minute;
-        tm.tm_sec = second;
-        time_t time = mktime(&tm);
-        struct tm* result = localtime(&time);
-        return Date(result->tm_year + 1900, result->tm_mon + 1, result->tm_mday, result->tm_hour, result->tm_min, result->tm_sec);
+        CivilDate c = civil_from_days(days_from_civil(year, month, day) + days);
+        return Date(c.year, static_cast<int>(c.month), static_cast<int>(c.day), hour, minute, second);
     }
 };
 
@@ -102,6 +268,9 @@ Date parseDate(const string& dateStr) {
         dash1 != '-' || dash2 != '-' || dash3 != '-' || dash4 != '-' || dash5 != '-') {
         throw invalid_argument("Invalid format. Use YYYY-MM-DD-HH-MM-SS");
     }
+    if (!valid_civil(y, m, d) || h < 0 || h > 23 || min < 0 || min > 59 || s < 0 || s > 59) {
+        throw invalid_argument("Invalid date values");
+    }
     return Date(y, m, d, h, min, s);
 }
 
@@ -109,40 +278,557 @@ Date parseDate(const string& dateStr) {
 
 // Get number of jiffies from Jan 1, 1980 to virtual today 9:00 AM
 uint64_t jiffies_from_1980(const Date& dt) {
-    tm base_tm = {};
-    base_tm.tm_year = 1980 - 1900;
-    base_tm.tm_mon = 0;
-    base_tm.tm_mday = 1;
-    base_tm.tm_hour = 0;
-    base_tm.tm_min = 0;
-    base_tm.tm_sec = 0;
-    time_t base_time = mktime(&base_tm);
-
-    tm target_tm = {};
-    target_tm.tm_year = dt.year - 1900;
-    target_tm.tm_mon = dt.month - 1;
-    target_tm.tm_mday = dt.day;
-    target_tm.tm_hour = dt.hour;
-    target_tm.tm_min = dt.minute;
-    target_tm.tm_sec = dt.second;
-    time_t target_time = mktime(&target_tm);
-
-    return static_cast<uint64_t>(target_time - base_time) * JIFFIES_PER_SEC;
+    return civil_to_jiffies(dt.year, dt.month, dt.day, dt.hour, dt.minute, dt.second);
+}
+
+// First trading day on or after `date`, at the same time of day
+Date next_trading_date(const TradingCalendar& calendar, const Date& date) {
+    int64_t days = days_from_civil(date.year, date.month, date.day);
+    return date.addDays(static_cast<int>(calendar.next_trading_day(days) - days));
+}
+
+// Jiffies a replay of `date` covers: its trading session, clipped to the requested range
+void day_window(const Date& date, uint64_t start_jiffi, uint64_t end_jiffi, uint64_t& base_jiffi, uint64_t& last_jiffi) {
+    base_jiffi = max(jiffies_from_1980(date), start_jiffi);
+    last_jiffi = min(base_jiffi + TOTAL_SECONDS * JIFFIES_PER_SEC, end_jiffi);
+}
+
+// Byte range of a sorted .DAT file that covers jiffies [start_jiffi, end_jiffi], from the file's sparse
+// index. The index is built, and saved next to the file, on first use or once the file has changed.
+// Falls back to the whole file when the file can't be indexed.
+void indexed_range(const string& path, uint64_t start_jiffi, uint64_t end_jiffi, uint64_t& begin, uint64_t& end) {
+    begin = 0;
+    end = UINT64_MAX;
+    auto index_start = Clock::now();
+    SparseIndex index;
+    string error;
+    if (!index.load(path, error)) {
+        cout << "Sparse index: " << error << ", building it\n";
+        bool saved = false;
+        if (!index.build(path, error, saved)) {
+            cout << "Sparse index unavailable: " << error << "; reading the whole file\n";
+            return;
+        }
+        if (!saved) {
+            cout << "Sparse index: unable to write " << SparseIndex::sidecar_path(path) << ", using it for this run only\n";
+        }
+    }
+    index.range(start_jiffi, end_jiffi, begin, end);
+    cout << "Sparse index: " << index.buckets() << " one-second buckets, reading bytes " << begin << "-" << end
+         << " (" << (end - begin) / (1 << 20) << " of " << index.file_size() / (1 << 20) << " MiB) in "
+         << chrono::duration<double, milli>(Clock::now() - index_start).count() << " ms\n";
 }
 
 // -----------------------------------------------------------------------------------------------------
 
-void sleep_until_next_9am() {
-    cout << "[INFO] Sleeping until next market day...\n";
-    this_thread::sleep_for(chrono::seconds(10)); 
+// Sleep through long gaps between populated jiffies, then spin on the TSC deadline for the last stretch
+bool wait_until(const Pacer& pacer, uint64_t jiffies) {
+    constexpr uint64_t SPIN_SLACK_NS = 200'000;
+    constexpr uint64_t MAX_SLEEP_NS = 100'000'000;
+
+    for (uint64_t left = pacer.ns_until(jiffies); left > SPIN_SLACK_NS; left = pacer.ns_until(jiffies)) {
+        if (!keep_running) return false;
+        this_thread::sleep_for(chrono::nanoseconds(min(left - SPIN_SLACK_NS, MAX_SLEEP_NS)));
+    }
+    pacer.wait(jiffies);
+    return keep_running;
+}
+
+// -----------------------------------------------------------------------------------------------------
+
+// FNV-1a over the padded symbol field, so a symbol lands on the same shard in either record format
+uint32_t symbol_hash(const char* symbol) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < DAT_SYMBOL_SIZE; i++) {
+        h = (h ^ static_cast<unsigned char>(symbol[i])) * 16777619u;
+    }
+    return h;
+}
+
+// Split the records of jiffies [first_jiffi, last_jiffi] by symbol hash across the buffers in `out`, keeping
+// jiffy and record order. The buffers are emptied first but keep their capacity.
+void split_jiffi_records(const ReplayView& src, uint64_t first_jiffi, uint64_t last_jiffi, vector<ReplayBuffer>& out) {
+    size_t shard_count = out.size();
+    for (auto& b : out) {
+        b.index.clear();
+        b.body.clear();
+        b.record_size = src.record_size;
+        b.record_format = src.record_format;
+        b.symbols = src.symbols;
+        b.symbol_count = src.symbol_count;
+    }
+
+    bool binary = src.record_format == RECORD_FORMAT_BINARY;
+    vector<uint32_t> id_shard(binary && shard_count > 1 ? src.symbol_count : 0);
+    for (size_t id = 0; id < id_shard.size(); id++) {
+        id_shard[id] = symbol_hash(src.symbols + id * DAT_SYMBOL_SIZE) % shard_count;
+    }
+
+    for (const JiffyIndexEntry* it = src.lower_bound(first_jiffi); it != src.end() && it->jiffy <= last_jiffi; ++it) {
+        const JiffyIndexEntry& e = *it;
+        const char* rec = src.records(e);
+        if (shard_count == 1) {
+            ReplayBuffer& b = out[0];
+            b.index.push_back(JiffyIndexEntry{e.jiffy, b.body.size() / b.record_size, e.record_count, 0});
+            b.body.insert(b.body.end(), rec, rec + src.bytes(e));
+            continue;
+        }
+        for (uint32_t r = 0; r < e.record_count; r++, rec += src.record_size) {
+            uint32_t s = binary ? id_shard[reinterpret_cast<const BinaryRecord*>(rec)->symbol_id]
+                                : symbol_hash(rec + DAT_SYMBOL_OFFSET) % shard_count;
+            ReplayBuffer& b = out[s];
+            if (b.index.empty() || b.index.back().jiffy != e.jiffy) {
+                b.index.push_back(JiffyIndexEntry{e.jiffy, b.body.size() / b.record_size, 0, 0});
+            }
+            b.body.insert(b.body.end(), rec, rec + src.record_size);
+            b.index.back().record_count++;
+        }
+    }
+}
+
+// Split records by symbol hash into one replay buffer per shard
+vector<ReplayBuffer> shard_jiffi_records(const ReplayView& src, size_t shard_count) {
+    vector<ReplayBuffer> out(shard_count);
+    split_jiffi_records(src, 0, UINT64_MAX, out);
+    return out;
+}
+
+// -----------------------------------------------------------------------------------------------------
+
+// Replay source for .DAT files too big to load: records are parsed straight out of BlockReader's
+// read-ahead blocks and cut into days, so memory holds the day buffers and the blocks in flight,
+// whatever the file size. The file must be sorted by jiffy; records that go back in time can't be
+// replayed in order and are dropped.
+class DatStream {
+public:
+    bool open(const string& path, const SymbolFilter* filter, string& error, uint64_t begin = 0, uint64_t end = UINT64_MAX) {
+        filter_ = filter;
+        return reader_.open(path, error, begin, end);
+    }
+
+    // Fill `out` with the records of jiffies [first_jiffi, last_jiffi], split by symbol hash across
+    // its buffers. Windows must come in increasing order: earlier records are skipped, and the first
+    // record past the window is held back for the next call.
+    void load_day(uint64_t first_jiffi, uint64_t last_jiffi, vector<ReplayBuffer>& out) {
+        for (auto& b : out) {
+            b.index.clear();
+            b.body.clear();
+        }
+
+        const char* rec;
+        while (next_record(rec)) {
+            uint64_t jiffy = 0;
+            if (!parse_record_jiffy(rec, jiffy)) {
+                malformed_++;
+                continue;
+            }
+            if (jiffy < last_jiffy_) {
+                out_of_order_++;
+                continue;
+            }
+            last_jiffy_ = jiffy;
+            if (jiffy < first_jiffi) continue;
+            if (jiffy > last_jiffi) {
+                // A day with no records hands the held-back one straight back: keep it in place
+                if (rec != held_) memcpy(held_, rec, RECORD_SIZE);
+                has_held_ = true;
+                return;
+            }
+            if (filter_ && !filter_->matches(rec + DAT_SYMBOL_OFFSET)) continue;
+
+            ReplayBuffer& b = out[out.size() > 1 ? symbol_hash(rec + DAT_SYMBOL_OFFSET) % out.size() : 0];
+            if (b.index.empty() || b.index.back().jiffy != jiffy) {
+                b.index.push_back(JiffyIndexEntry{jiffy, b.body.size() / RECORD_SIZE, 0, 0});
+            }
+            b.body.insert(b.body.end(), rec, rec + RECORD_SIZE);
+            b.index.back().record_count++;
+        }
+    }
+
+    const BlockReader& reader() const { return reader_; }
+    uint64_t records() const { return records_; }
+    uint64_t out_of_order() const { return out_of_order_; }
+    uint64_t malformed() const { return malformed_; }
+
+private:
+    // Next record, from the held-back one, the current block, or pieced together across two blocks
+    bool next_record(const char*& rec) {
+        if (has_held_) {
+            has_held_ = false;
+            rec = held_;
+            return true;
+        }
+        size_t carried = 0;
+        while (true) {
+            if (pos_ == len_) {
+                pos_ = 0;
+                len_ = reader_.next(block_);
+                if (len_ == 0) return false;
+            }
+            if (carried == 0 && len_ - pos_ >= RECORD_SIZE) {
+                rec = block_ + pos_;
+                pos_ += RECORD_SIZE;
+                records_++;
+                return true;
+            }
+            size_t n = min(RECORD_SIZE - carried, len_ - pos_);
+            memcpy(split_ + carried, block_ + pos_, n);
+            carried += n;
+            pos_ += n;
+            if (carried == RECORD_SIZE) {
+                rec = split_;
+                records_++;
+                return true;
+            }
+        }
+    }
+
+    BlockReader reader_;
+    const SymbolFilter* filter_ = nullptr;
+    const char* block_ = nullptr;
+    size_t len_ = 0;
+    size_t pos_ = 0;
+    char split_[RECORD_SIZE];
+    char held_[RECORD_SIZE];
+    bool has_held_ = false;
+    uint64_t last_jiffy_ = 0;
+
+    uint64_t records_ = 0;
+    uint64_t out_of_order_ = 0;
+    uint64_t malformed_ = 0;
+};
+
+// -----------------------------------------------------------------------------------------------------
+
+// Loads the next day's records on a background thread while the current day replays. There are two
+// day buffers (one ReplayBuffer per shard each): the replay reads one while the loader fills the
+// other, so memory stays at two days and a day boundary only swaps which buffer the shards point at.
+class DayPrefetcher {
+public:
+    using Loader = function<void(uint64_t first_jiffi, uint64_t last_jiffi, vector<ReplayBuffer>& out)>;
+
+    DayPrefetcher(size_t shard_count, Loader load) : load_(move(load)) {
+        for (auto& b : buffers_) b.resize(shard_count);
+        loader_ = thread([this] { run(); });
+    }
+
+    ~DayPrefetcher() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        loader_.join();
+    }
+
+    // Start loading jiffies [first_jiffi, last_jiffi] into the buffer not being replayed
+    void prefetch(uint64_t first_jiffi, uint64_t last_jiffi) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            first_ = first_jiffi;
+            last_ = last_jiffi;
+            state_ = REQUESTED;
+        }
+        cv_.notify_all();
+    }
+
+    // Wait for the prefetched day and hand over its buffers. They are left alone until the
+    // prefetch() that follows the next take().
+    const vector<ReplayBuffer>& take() {
+        auto wait_start = Clock::now();
+        unique_lock<mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return state_ == READY; });
+        wait_ms_ = chrono::duration<double, milli>(Clock::now() - wait_start).count();
+        state_ = IDLE;
+        size_t taken = filling_;
+        taken_load_ms_ = load_ms_[taken];
+        filling_ ^= 1;
+        return buffers_[taken];
+    }
+
+    // Of the day last taken: time the loader spent on it, and time take() waited for it
+    double load_ms() const { return taken_load_ms_; }
+    double wait_ms() const { return wait_ms_; }
+
+private:
+    enum State { IDLE, REQUESTED, READY };
+
+    void run() {
+        unique_lock<mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stop_ || state_ == REQUESTED; });
+            if (stop_) return;
+            size_t slot = filling_;
+            uint64_t first = first_, last = last_;
+            lock.unlock();
+
+            auto load_start = Clock::now();
+            load_(first, last, buffers_[slot]);
+            double ms = chrono::duration<double, milli>(Clock::now() - load_start).count();
+
+            lock.lock();
+            load_ms_[slot] = ms;
+            state_ = READY;
+            cv_.notify_all();
+        }
+    }
+
+    Loader load_;
+    vector<ReplayBuffer> buffers_[2];
+    double load_ms_[2] = {0, 0};
+
+    mutex mutex_;
+    condition_variable cv_;
+    State state_ = IDLE;
+    bool stop_ = false;
+    size_t filling_ = 0;
+    uint64_t first_ = 0;
+    uint64_t last_ = 0;
+
+    double taken_load_ms_ = 0;
+    double wait_ms_ = 0;
+    thread loader_;
+};
+
+// -----------------------------------------------------------------------------------------------------
+
+sockaddr_in loopback_dest(size_t port) {
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &dest.sin_addr);
+    return dest;
+}
+
+// One replay lane: its slice of the records, its own socket and destination port
+struct ReplayShard {
+    ReplayView records;
+    int sock = -1;
+    int cpu = -1;
+    unique_ptr<UdpBatchSender> sender;
+    unique_ptr<JiffyPacketizer> packetizer;
+
+    uint64_t found = 0;
+    uint64_t current_jiffi = 0;
+
+    // Next jiffy this shard will send; read by the other shards to bound their lead. Set to
+    // the day's base jiffy before any shard of the day starts, SHARD_DONE once it finishes.
+    alignas(64) atomic<uint64_t> progress{0};
+    char padding[64 - sizeof(atomic<uint64_t>)];
+};
+
+struct ReplaySession {
+    uint64_t base_jiffi = 0;
+    uint64_t last_jiffi = 0;
+    uint64_t factor = 0;
+    size_t mtu = 0;
+    uint64_t max_skew = 0;
+    const Pacer* pacer = nullptr;
+    const vector<unique_ptr<ReplayShard>>* shards = nullptr;     // null: the shard replays alone
+};
+
+constexpr uint64_t SHARD_DONE = UINT64_MAX;
+
+// In as-fast-as-possible mode, keep a shard within max_skew jiffies of the slowest shard
+bool wait_for_shards(ReplayShard& shard, const ReplaySession& session, uint64_t jiffy, uint64_t& horizon) {
+    if (!session.shards) return true;
+    bool flushed = false;
+    while (jiffy > horizon) {
+        if (!keep_running) return false;
+        uint64_t slowest = SHARD_DONE;
+        for (const auto& other : *session.shards) {
+            slowest = min(slowest, other->progress.load(memory_order_acquire));
+        }
+        horizon = slowest > SHARD_DONE - session.max_skew ? SHARD_DONE : slowest + session.max_skew;
+        if (jiffy > horizon) {
+            // Don't sit on a partial batch while the other shards catch up
+            if (!flushed) {
+                shard.sender->flush();
+                flushed = true;
+            }
+            this_thread::yield();
+        }
+    }
+    return true;
+}
+
+void replay_shard(ReplayShard& shard, const ReplaySession& session) {
+    if (shard.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(shard.cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    }
+
+    // A progress left at SHARD_DONE from the previous day would let the other shards run
+    // unbounded before this one starts
+    if (session.shards && shard.progress.load(memory_order_acquire) != session.base_jiffi) {
+        cerr << "Error: shard progress not reset for the day; refusing to replay without lockstep\n";
+        shard.progress.store(SHARD_DONE, memory_order_release);
+        return;
+    }
+
+    const ReplayView& records = shard.records;
+    UdpBatchSender& sender = *shard.sender;
+    sender.reset_stats();
+    shard.packetizer->start_session();
+    shard.found = 0;
+    shard.current_jiffi = session.base_jiffi;
+
+    auto send_jiffy = [&](const JiffyIndexEntry& e) {
+        shard.found += e.record_count;
+        if (session.mtu == 0) {
+            // Records of one jiffy are contiguous in the image, so they go out as-is
+            sender.add(records.records(e), records.bytes(e));
+        } else {
+            shard.packetizer->send(e.jiffy, records.records(e), e.record_count);
+        }
+    };
+
+    // Index entries are sorted; the cursor only ever visits populated jiffies
+    const JiffyIndexEntry* it = records.lower_bound(session.base_jiffi);
+
+    if(session.factor==0){
+        // Jump straight from one populated jiffy to the next; empty jiffies cost nothing
+        uint64_t horizon = 0;
+        for(;keep_running && it != records.end() && it->jiffy <= session.last_jiffi; ++it){
+            shard.progress.store(it->jiffy, memory_order_release);
+            if(!wait_for_shards(shard, session, it->jiffy, horizon)){
+                break;
+            }
+            send_jiffy(*it);
+            shard.current_jiffi = it->jiffy + 1;
+        }
+        shard.progress.store(SHARD_DONE, memory_order_release);
+        if(keep_running){
+            shard.current_jiffi = session.last_jiffi + 1;
+        }
+    }else{
+        // Sleep or spin to the TSC deadline of each populated jiffy at <factor>x real time
+        const Pacer& pacer = *session.pacer;
+        for(;keep_running && it != records.end() && it->jiffy < session.last_jiffi; ++it){
+            uint64_t offset = it->jiffy - session.base_jiffi;
+            // Nothing else can join the batch before the next jiffy, so don't hold it past its deadline
+            if(sender.pending() && sender.deadline() < Clock::now() + chrono::nanoseconds(pacer.ns_until(offset))){
+                sender.flush();
+            }
+            if(!wait_until(pacer, offset)){
+                break;
+            }
+            send_jiffy(*it);
+            shard.current_jiffi = it->jiffy + 1;
+        }
+        sender.flush();
+        // Hold the session open until its last jiffy, as the dense loop did
+        if(keep_running && wait_until(pacer, session.last_jiffi - session.base_jiffi)){
+            shard.current_jiffi = session.last_jiffi;
+        }
+    }
+    sender.flush();
+}
+
+// Socket, batch sender and packetizer for one lane sending to 127.0.0.1:<port>; null if the socket fails
+unique_ptr<ReplayShard> open_shard(const ReplayView& records, int cpu, size_t port, size_t batch_size, uint64_t batch_us,
+                                   size_t mtu, bool use_gso) {
+    auto shard = make_unique<ReplayShard>();
+    shard->records = records;
+    shard->cpu = cpu;
+
+    shard->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (shard->sock < 0) {
+        perror("Socket creation failed");
+        return nullptr;
+    }
+
+    shard->sender = make_unique<UdpBatchSender>(shard->sock, loopback_dest(port), batch_size, chrono::microseconds(batch_us));
+    shard->packetizer = make_unique<JiffyPacketizer>(*shard->sender, shard->sock, mtu, records.record_size, use_gso);
+    return shard;
+}
+
+// -----------------------------------------------------------------------------------------------------
+
+// One trading day of a multi-day run and, once replayed, what it sent
+struct ReplayDay {
+    explicit ReplayDay(const Date& d) : date(d) {}
+
+    Date date;
+    uint64_t base_jiffi = 0;
+    uint64_t last_jiffi = 0;
+    size_t port = 0;
+
+    int cpu = -1;
+    uint64_t ticks = 0;
+    uint64_t found = 0;
+    uint64_t fragments = 0;
+    UdpBatchSender::Stats send_stats{};
+    double seconds = 0;
+};
+
+// At factor 0 days don't depend on each other: each worker lane, pinned to its own CPU, takes the
+// next day nobody has started and replays it to that day's port, so wall time drops with the lane count
+void replay_days_parallel(vector<ReplayDay>& days, vector<unique_ptr<ReplayShard>>& lanes, size_t mtu) {
+    atomic<size_t> next_day{0};
+
+    auto run_lane = [&](ReplayShard& lane) {
+        for (size_t d = next_day.fetch_add(1); d < days.size() && keep_running; d = next_day.fetch_add(1)) {
+            ReplayDay& day = days[d];
+            lane.sender->set_dest(loopback_dest(day.port));
+
+            ReplaySession session;
+            session.base_jiffi = day.base_jiffi;
+            session.last_jiffi = day.last_jiffi;
+            session.mtu = mtu;
+
+            auto start_time = chrono::high_resolution_clock::now();
+            replay_shard(lane, session);
+            auto end_time = chrono::high_resolution_clock::now();
+
+            day.cpu = lane.cpu;
+            day.ticks = lane.current_jiffi - day.base_jiffi;
+            day.found = lane.found;
+            day.fragments = lane.packetizer->datagrams();
+            day.send_stats = lane.sender->stats();
+            day.seconds = chrono::duration<double>(end_time - start_time).count();
+        }
+    };
+
+    vector<thread> workers;
+    for (auto& lane : lanes) {
+        workers.emplace_back(run_lane, ref(*lane));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
 }
 
 // -----------------------------------------------------------------------------------------------------
 
 void printUsage(const char* program_name) {
-    cout << "Usage: " << program_name << " <start_date> <end_date>\n";
-    cout << "Date format: YYYY-MM-DD\n";
-    cout << "Example: " << program_name << " 2024-09-02 2024-09-30\n";
+    cout << "Usage: " << program_name << " <start_date> <end_date> [replay_image] [options]\n";
+    cout << "Date format: YYYY-MM-DD-HH-MM-SS\n";
+    cout << "Options:\n";
+    cout << "  --batch N       datagrams per sendmmsg() batch (default 64, 1 = one send per jiffy)\n";
+    cout << "  --batch-us N    max microseconds a datagram may wait in a batch (default 100)\n";
+    cout << "  --mtu N         split jiffy batches into framed datagrams of at most N bytes (default 1500,\n";
+    cout << "                  0 = one unframed datagram per jiffy)\n";
+    cout << "  --no-gso        don't hand fragments to the kernel with UDP_SEGMENT\n";
+    cout << "  --symbols LIST  replay only these comma-separated symbols\n";
+    cout << "  --symbols-file F  replay only the symbols listed in F, one per line\n";
+    cout << "  --shards N      split symbols by hash across N pinned sender threads (default 1)\n";
+    cout << "  --port P        destination port of shard 0; shard i sends to P+i (default 9000)\n";
+    cout << "  --cpu-base C    pin shard i to CPU C+i (default 0)\n";
+    cout << "  --speed X       replay at X times real time, paced on the TSC (default 0 = as fast as possible)\n";
+    cout << "  --max-skew J    max jiffies a shard may run ahead of the slowest one at factor 0 (default 64)\n";
+    cout << "  --parallel-days N  at factor 0, replay N days at once on pinned workers (CPU C..C+N-1);\n";
+    cout << "                  day d of the range sends to port P+d\n";
+    cout << "  --prefetch      copy each day out of the image on a loader thread while the previous day replays\n";
+    cout << "  --stream F      stream the sorted .DAT file F in read-ahead blocks (io_uring when available)\n";
+    cout << "                  instead of loading it; memory stays at two days of records (implies --prefetch)\n";
+    cout << "  --holidays F    replay only weekdays not listed in holiday file F (default holidays.txt)\n";
+    cout << "  --no-index      read the whole .DAT file instead of seeking with its sparse index (<file>.idx)\n";
+    cout << "Example: " << program_name << " 2024-09-02-09-00-00 2024-09-30-17-00-00 Data/sorted_filtered_data5.img\n";
+    cout << "Without a replay image, " << filename << " is preprocessed in memory (see build_replay_image)\n";
+    cout << "Images built with --binary replay 72-byte binary records instead of 88-byte ASCII ones\n";
 }
 
 // -----------------------------------------------------------------------------------------------------
@@ -157,7 +843,7 @@ int main(int argc, char* argv[]) {
 
     // -----------------------------------------------------------------------------------------------------
 
-    if (argc != 3) {
+    if (argc < 3) {
         printUsage(argv[0]);
         return 1;
     }
@@ -172,63 +858,293 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    string image_path;
+    size_t batch_size = 64;
+    uint64_t batch_us = 100;
+    size_t mtu = 1500;
+    bool use_gso = true;
+    SymbolFilter symbol_filter;
+    string filter_error;
+    size_t shard_count = 1;
+    size_t base_port = 9000;
+    size_t cpu_base = 0;
+    uint64_t max_skew = 64;
+    uint64_t factor = 0;      // 0 = as fast as possible, otherwise replay speed (1 = real time)
+    size_t parallel_days = 1;
+    bool prefetch = false;
+    string stream_path;
+    bool use_index = true;
+    string holidays_file = "holidays.txt";
+    bool holidays_given = false;
+
+    try {
+        for (int a = 3; a < argc; a++) {
+            string arg = argv[a];
+            if (arg == "--batch" && a + 1 < argc) {
+                batch_size = stoul(argv[++a]);
+            } else if (arg == "--batch-us" && a + 1 < argc) {
+                batch_us = stoull(argv[++a]);
+            } else if (arg == "--mtu" && a + 1 < argc) {
+                mtu = stoul(argv[++a]);
+            } else if (arg == "--no-gso") {
+                use_gso = false;
+            } else if (arg == "--symbols" && a + 1 < argc) {
+                if (!symbol_filter.add_list(argv[++a], filter_error)) throw invalid_argument(arg);
+            } else if (arg == "--symbols-file" && a + 1 < argc) {
+                if (!symbol_filter.load_file(argv[++a], filter_error)) throw invalid_argument(arg);
+            } else if (arg == "--shards" && a + 1 < argc) {
+                shard_count = stoul(argv[++a]);
+                if (shard_count == 0) throw invalid_argument(arg);
+            } else if (arg == "--port" && a + 1 < argc) {
+                base_port = stoul(argv[++a]);
+            } else if (arg == "--cpu-base" && a + 1 < argc) {
+                cpu_base = stoul(argv[++a]);
+            } else if (arg == "--speed" && a + 1 < argc) {
+                factor = stoull(argv[++a]);
+            } else if (arg == "--max-skew" && a + 1 < argc) {
+                max_skew = stoull(argv[++a]);
+            } else if (arg == "--parallel-days" && a + 1 < argc) {
+                parallel_days = stoul(argv[++a]);
+                if (parallel_days == 0) throw invalid_argument(arg);
+            } else if (arg == "--prefetch") {
+                prefetch = true;
+            } else if (arg == "--holidays" && a + 1 < argc) {
+                holidays_file = argv[++a];
+                holidays_given = true;
+            } else if (arg == "--no-index") {
+                use_index = false;
+            } else if (arg == "--stream" && a + 1 < argc) {
+                stream_path = argv[++a];
+                prefetch = true;
+            } else if (arg.rfind("--", 0) != 0 && image_path.empty()) {
+                image_path = arg;
+            } else {
+                throw invalid_argument(arg);
+            }
+        }
+    } catch (...) {
+        if (!filter_error.empty()) {
+            cerr << "Error: " << filter_error << "\n";
+        }
+        printUsage(argv[0]);
+        return 1;
+    }
+
     if (!(start_date <= end_date)) {
         cerr << "Error: Start datetime must be before or equal to end datetime\n";
         return 1;
     }
 
+    if (parallel_days > 1 && (factor != 0 || shard_count > 1)) {
+        cerr << "Error: --parallel-days needs as-fast-as-possible replay (no --speed) and a single shard\n";
+        return 1;
+    }
+    if (parallel_days > 1 && prefetch) {
+        cerr << "Error: --prefetch and --stream can't be combined with --parallel-days\n";
+        return 1;
+    }
+    if (!stream_path.empty() && !image_path.empty()) {
+        cerr << "Error: give either a replay image or --stream, not both\n";
+        return 1;
+    }
+
     uint64_t start_jiffi = jiffies_from_1980(start_date);
     uint64_t end_jiffi = jiffies_from_1980(end_date);
 
     cout << "Starting tick generation from " << start_date.toString() << " (Jiffi: " << start_jiffi << ") " << " to " << end_date.toString() << " (Jiffi: " << end_jiffi << ") " << endl;
 
-    Date current_date = start_date;
+    TradingCalendar calendar;
+    string calendar_error;
+    if (calendar.load(holidays_file, calendar_error)) {
+        cout << "Trading calendar: " << calendar.holidays() << " holidays from " << holidays_file << "\n";
+    } else if (holidays_given) {
+        cerr << "Error: " << calendar_error << "\n";
+        return 1;
+    } else {
+        cout << "Trading calendar: no holiday file, trading every weekday\n";
+    }
+
+    // Weekends and holidays are never visited: no replay, no sleep
+    Date current_date = next_trading_date(calendar, start_date);
+    Date last_date = current_date;
     int total_days = 0;
 
     // -----------------------------------------------------------------------------------------------------
 
-    auto jiffi_records = preprocess_jiffi_map(filename);
-
-    // -----------------------------------------------------------------------------------------------------
+    ReplayImage image;
+    ReplayBuffer buffer;
+    ReplayView jiffi_records;
+    DatStream stream;
+
+    auto load_start = chrono::high_resolution_clock::now();
+    if (!stream_path.empty()) {
+        string error;
+        uint64_t begin = 0, end = UINT64_MAX;
+        if (use_index) {
+            indexed_range(stream_path, start_jiffi, end_jiffi, begin, end);
+        }
+        if (!stream.open(stream_path, symbol_filter.empty() ? nullptr : &symbol_filter, error, begin, end)) {
+            cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        cout << "Streaming " << stream_path << " (" << stream.reader().size() / (1 << 20) << " MiB) in "
+             << BlockReader::BLOCK_BYTES / 1024 << " KiB blocks, " << BlockReader::QUEUE_DEPTH << " in flight, via "
+             << (stream.reader().using_io_uring() ? "io_uring" : "ifstream") << "\n";
+    } else if (!image_path.empty()) {
+        string error;
+        if (!image.open(image_path, error)) {
+            cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        jiffi_records = image.view();
+    } else {
+        uint64_t begin = 0, end = UINT64_MAX;
+        if (use_index) {
+            indexed_range(filename, start_jiffi, end_jiffi, begin, end);
+        }
+        buffer = preprocess_jiffi_map(filename, begin, end);
+        jiffi_records = buffer.view();
+    }
+    if (!symbol_filter.empty() && stream_path.empty()) {
+        buffer = filter_jiffi_records(jiffi_records, symbol_filter);
+        jiffi_records = buffer.view();
+        cout << "Filtered to " << symbol_filter.size() << " symbols\n";
+    }
+    auto load_end = chrono::high_resolution_clock::now();
 
-    vector<string> batch_records;
-    constexpr int RECORD_SIZE = 88;
-    // string line(RECORD_SIZE, '\0');
-    // string jiffy_str = "";
-    // uint64_t jiffies = 0;
-    // string symbol_raw = "";
-    
-    // ifstream file(filename, ios::binary);
-    // if (!file) {
-    //     cerr << "Failed to open file\n";
-    //     return 1;
-    // }
-
-    // string target_symbol1 = "ADANIENSOL";  
-    // string target_symbol2 = "bBAJAJHIND";
+    if (stream_path.empty()) {
+        cout << "Loaded " << jiffi_records.record_count
+             << (jiffi_records.record_format == RECORD_FORMAT_BINARY ? " binary" : " ASCII")
+             << " records over " << jiffi_records.jiffy_count << " jiffies in " << chrono::duration_cast<chrono::milliseconds>(load_end - load_start).count() << " ms\n";
+    }
 
     // -----------------------------------------------------------------------------------------------------
 
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sock < 0) {
-        perror("Socket creation failed");
-        return 1;
+    vector<unique_ptr<ReplayShard>> shards;
+    vector<ReplayBuffer> shard_buffers;
+    if (shard_count > 1 && !prefetch) {
+        shard_buffers = shard_jiffi_records(jiffi_records, shard_count);
     }
 
-    sockaddr_in dest{};
-    dest.sin_family = AF_INET;
-    dest.sin_port = htons(9000);
-    inet_pton(AF_INET, "127.0.0.1", &dest.sin_addr);
+    // Parallel days run one lane per worker over the whole image; the lanes retarget per day
+    size_t lane_count = parallel_days > 1 ? parallel_days : shard_count;
+    for (size_t i = 0; i < lane_count; i++) {
+        bool pinned = lane_count > 1;
+        auto shard = open_shard(shard_count > 1 && !prefetch ? shard_buffers[i].view() : jiffi_records,
+                                pinned ? static_cast<int>((cpu_base + i) % thread::hardware_concurrency()) : -1,
+                                base_port + i, batch_size, batch_us, mtu, use_gso);
+        if (!shard) {
+            return 1;
+        }
+        shards.push_back(move(shard));
+    }
+
+    if (mtu != 0) {
+        cout << "Framing " << shards[0]->packetizer->records_per_fragment() << " records per datagram"
+             << (shards[0]->packetizer->gso() ? " (UDP GSO)" : "") << "\n";
+    }
+    if (shard_count > 1) {
+        cout << "Replaying " << shard_count << " symbol shards to ports " << base_port << "-" << base_port + shard_count - 1
+             << ", max skew " << max_skew << " jiffies\n";
+        for (size_t i = 0; i < shard_count && !prefetch; i++) {
+            cout << "  Shard " << i << ": " << shards[i]->records.record_count << " records, CPU " << shards[i]->cpu << "\n";
+        }
+    }
 
     // -----------------------------------------------------------------------------------------------------
 
-    volatile uint64_t factor = 0;
+    if (parallel_days > 1) {
+        vector<ReplayDay> days;
+        for (Date d = current_date; d <= end_date; d = next_trading_date(calendar, d.addDays(1))) {
+            ReplayDay day(d);
+            day_window(d, start_jiffi, end_jiffi, day.base_jiffi, day.last_jiffi);
+            day.port = base_port + days.size();
+            days.push_back(day);
+        }
+
+        if (days.empty()) {
+            cout << "No trading days between " << start_date.toString() << " and " << end_date.toString() << "\n";
+            return 0;
+        }
+        cout << "Replaying " << days.size() << " days on " << shards.size() << " pinned workers to ports "
+             << base_port << "-" << base_port + days.size() - 1 << "\n";
+
+        auto start_time = chrono::high_resolution_clock::now();
+        replay_days_parallel(days, shards, mtu);
+        auto end_time = chrono::high_resolution_clock::now();
+
+        // -----------------------------------------------------------------------------------------------------
+
+        UdpBatchSender::Stats send_stats;
+        uint64_t total_ticks = 0, total_found = 0, fragments = 0;
+        double busy_seconds = 0;
+        size_t replayed = 0;
+
+        cout << "-----------------------------------------------------------------------------------------------------" << endl << endl;
+        for (const ReplayDay& day : days) {
+            if (day.cpu < 0) continue;      // never started (interrupted)
+            replayed++;
+            cout << "  " << day.date.toString() << "  port " << day.port << "  CPU " << day.cpu
+                 << "  ticks " << day.ticks << "  found " << day.found << "  datagrams " << day.send_stats.datagrams
+                 << "  " << day.seconds << " sec\n";
+            total_ticks += day.ticks;
+            total_found += day.found;
+            fragments += day.fragments;
+            busy_seconds += day.seconds;
+            send_stats.batches += day.send_stats.batches;
+            send_stats.datagrams += day.send_stats.datagrams;
+            send_stats.failed += day.send_stats.failed;
+            send_stats.max_batch = max(send_stats.max_batch, day.send_stats.max_batch);
+        }
+
+        double seconds = chrono::duration<double>(end_time - start_time).count();
+
+        cout << "\n--- Parallel Replay Ended ---\n";
+        cout << "Days replayed:           " << replayed << " / " << days.size() << "\n";
+        cout << "Workers:                 " << shards.size() << "\n";
+        cout << "Total Ticks:             " << total_ticks << "\n";
+        cout << "Wall Time:               " << seconds << " sec\n";
+        cout << "Summed Day Time:         " << busy_seconds << " sec\n";
+        cout << "Parallel speedup:        " << (seconds > 0 ? busy_seconds / seconds : 0.0) << "\n";
+        cout << "Tick Rate:               " << (total_ticks / seconds) << " ticks/sec\n";
+        cout << "Found:                   " << total_found << " \n";
+        cout << "Datagrams sent:          " << send_stats.datagrams << " \n";
+        if (mtu != 0) {
+            cout << "Framed fragments:        " << fragments << " \n";
+        }
+        cout << "Send failures:           " << send_stats.failed << " \n";
+        cout << "sendmmsg batches:        " << send_stats.batches << " \n";
+        cout << "Avg / max batch:         " << (send_stats.batches ? (double)send_stats.datagrams / send_stats.batches : 0.0)
+             << " / " << send_stats.max_batch << " \n";
+
+        for (auto& shard : shards) {
+            close(shard->sock);
+        }
+
+        cout << (keep_running ? "\n=== SIMULATION COMPLETE ===\n" : "\n=== SIMULATION INTERRUPTED ===\n");
+        cout << "Date range: " << start_date.toString() << " to " << end_date.toString() << "\n";
+        return 0;
+    }
+
     volatile uint64_t ticks = 0;
     volatile uint64_t found = 0;
-    volatile uint64_t sent = 0;
     volatile uint64_t base_jiffi = 0;
     uint64_t current_jiffi = 0;
-    auto it = jiffi_records.find(current_jiffi);
+
+    // Day N+1 is copied out while day N replays; the shards are pointed at it at the day boundary
+    unique_ptr<DayPrefetcher> prefetcher;
+    if (prefetch) {
+        prefetcher = make_unique<DayPrefetcher>(shard_count, [&](uint64_t first, uint64_t last, vector<ReplayBuffer>& out) {
+            if (!stream_path.empty()) {
+                stream.load_day(first, last, out);
+            } else {
+                split_jiffi_records(jiffi_records, first, last, out);
+            }
+        });
+        uint64_t first = 0, last = 0;
+        day_window(current_date, start_jiffi, end_jiffi, first, last);
+        prefetcher->prefetch(first, last);
+    }
 
     // -----------------------------------------------------------------------------------------------------
 
@@ -236,114 +1152,59 @@ int main(int argc, char* argv[]) {
 
         ticks = 0;
         found = 0;
-        sent = 0;
 
-        base_jiffi = jiffies_from_1980(current_date);
-        if(start_jiffi>base_jiffi){
-            base_jiffi = start_jiffi;
-        }
+        uint64_t day_first = 0, day_last = 0;
+        day_window(current_date, start_jiffi, end_jiffi, day_first, day_last);
+        base_jiffi = day_first;
         current_jiffi = base_jiffi;
-        TOTAL_JIFFIES = base_jiffi + TOTAL_SECONDS * JIFFIES_PER_SEC;
-        if(end_jiffi<TOTAL_JIFFIES){
-            TOTAL_JIFFIES = end_jiffi;
-        }
+        TOTAL_JIFFIES = day_last;
         cout << "-----------------------------------------------------------------------------------------------------" << endl << endl;
         cout << "Jiffies before today start: " << base_jiffi << endl;
         cout << "Starting tick generation for " << current_date.toString() << "...\n";
 
+        if (prefetcher) {
+            const vector<ReplayBuffer>& day = prefetcher->take();
+            for (size_t i = 0; i < shards.size(); i++) {
+                shards[i]->records = day[i].view();
+            }
+            Date next_date = next_trading_date(calendar, current_date.addDays(1));
+            if (next_date <= end_date) {
+                uint64_t next_first = 0, next_last = 0;
+                day_window(next_date, start_jiffi, end_jiffi, next_first, next_last);
+                prefetcher->prefetch(next_first, next_last);
+            }
+            cout << "Day loaded in " << prefetcher->load_ms() << " ms, replay waited " << prefetcher->wait_ms() << " ms\n";
+        }
+
+        ReplaySession session;
+        session.base_jiffi = base_jiffi;
+        session.last_jiffi = TOTAL_JIFFIES;
+        session.factor = factor;
+        session.mtu = mtu;
+        session.max_skew = max_skew;
+        session.shards = &shards;
+
+        Pacer pacer(factor, JIFFIES_PER_SEC);
         auto start_time = chrono::high_resolution_clock::now();
 
-        if(factor==0){
-            for(;keep_running && current_jiffi <= TOTAL_JIFFIES;){
-
-                batch_records.clear();
-                // while (file.read(&line[0], RECORD_SIZE)) {
-                //     jiffy_str = line.substr(22, 14);
-                //     jiffies = stoull(jiffy_str);
-
-                //     if (jiffies < current_jiffi) {
-                //         continue; 
-                //     } else if (jiffies == current_jiffi) {
-                //         batch_records.push_back(line);
-                //         found++;
-                //         // symbol_raw = line.substr(38, 10);
-
-                //         // if (symbol_raw == target_symbol1 || symbol_raw == target_symbol2) {
-                //         //     batch_records.push_back(line);
-                //         //     found++;
-                //         // }
-                //     } else {
-                //         // cout<<jiffies<<endl;
-                //         file.seekg(-RECORD_SIZE, ios::cur);
-                //         break;
-                //     }
-                // }
-
-                it = jiffi_records.find(current_jiffi);
-                if (it != jiffi_records.end()) {
-                    batch_records = it->second;
-                    found += batch_records.size();
-                } 
-                
-                if (!batch_records.empty()) {
-                    string payload;
-                    for (const auto& rec : batch_records) {
-                        payload += rec;
-                    }
-                    ssize_t s = sendto(sock, payload.data(), payload.size(), 0, (sockaddr*)&dest, sizeof(dest));
-                    if(s>0){
-                        sent++;
-                    }
-                }
-
-                current_jiffi++;
+        // No shard may see another's SHARD_DONE from yesterday: all of them start the day at its
+        // base jiffy before the first worker runs
+        for (auto& shard : shards) {
+            shard->progress.store(base_jiffi, memory_order_release);
+        }
+
+        // Every shard paces against the same session start, so they share one jiffy clock
+        pacer.start();
+        session.pacer = &pacer;
+        if (shards.size() == 1) {
+            replay_shard(*shards[0], session);
+        } else {
+            vector<thread> workers;
+            for (auto& shard : shards) {
+                workers.emplace_back(replay_shard, ref(*shard), cref(session));
             }
-        }else{
-            for(;keep_running && current_jiffi < TOTAL_JIFFIES;){
-
-                batch_records.clear();
-                // while (file.read(&line[0], RECORD_SIZE)) {
-                //     jiffy_str = line.substr(22, 14);
-                //     jiffies = stoull(jiffy_str);
-
-                //     if (jiffies < current_jiffi) {
-                //         continue; 
-                //     } else if (jiffies == current_jiffi) {
-                //         batch_records.push_back(line);
-                //         found++;
-                //         // symbol_raw = line.substr(38, 10);
-
-                //         // if (symbol_raw == target_symbol1 || symbol_raw == target_symbol2) {
-                //         //     batch_records.push_back(line);
-                //         //     found++;
-                //         // }
-                //     } else {
-                //         file.seekg(-RECORD_SIZE, ios::cur);
-                //         break;
-                //     }
-                // }
-
-                it = jiffi_records.find(current_jiffi);
-                if (it != jiffi_records.end()) {
-                    batch_records = it->second;
-                    found += batch_records.size();
-                } 
-                
-                if (!batch_records.empty()) {
-                    string payload;
-                    for (const auto& rec : batch_records) {
-                        payload += rec;
-                    }
-                    ssize_t s = sendto(sock, payload.data(), payload.size(), 0, (sockaddr*)&dest, sizeof(dest));
-                    if(s>0){
-                        sent++;
-                    }
-                }
-
-                current_jiffi++;
-
-                volatile int i = 0;
-                while(i<factor){i++;};
+            for (auto& worker : workers) {
+                worker.join();
             }
         }
         
@@ -351,6 +1212,19 @@ int main(int argc, char* argv[]) {
 
         // -----------------------------------------------------------------------------------------------------
 
+        UdpBatchSender::Stats send_stats;
+        uint64_t fragments = 0;
+        for (auto& shard : shards) {
+            found += shard->found;
+            current_jiffi = max(current_jiffi, shard->current_jiffi);
+            const auto& st = shard->sender->stats();
+            send_stats.batches += st.batches;
+            send_stats.datagrams += st.datagrams;
+            send_stats.failed += st.failed;
+            send_stats.max_batch = max(send_stats.max_batch, st.max_batch);
+            fragments += shard->packetizer->datagrams();
+        }
+
         ticks = current_jiffi - base_jiffi;
 
         auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
@@ -364,20 +1238,43 @@ int main(int argc, char* argv[]) {
         cout << "Tick Rate:               " << (ticks / seconds) << " ticks/sec\n";
         cout << "Speedup factor observed: " << ((ticks / seconds)/65536) << endl;
         cout << "Found:                   " << found << " \n";
-        cout << "Sent:                    " << sent << " \n";
+        cout << "Datagrams sent:          " << send_stats.datagrams << " \n";
+        if (mtu != 0) {
+            cout << "Framed fragments:        " << fragments << " \n";
+        }
+        cout << "Send failures:           " << send_stats.failed << " \n";
+        cout << "sendmmsg batches:        " << send_stats.batches << " \n";
+        cout << "Avg / max batch:         " << (send_stats.batches ? (double)send_stats.datagrams / send_stats.batches : 0.0)
+             << " / " << send_stats.max_batch << " \n";
+        if (shards.size() > 1) {
+            for (size_t i = 0; i < shards.size(); i++) {
+                cout << "  Shard " << i << " found:        " << shards[i]->found << " \n";
+            }
+        }
         cout << endl;
 
         cout << "Jiffies after end: " << TOTAL_JIFFIES << endl;
         
         // -----------------------------------------------------------------------------------------------------
 
-        current_date = current_date.addDays(1);
+        // Every shard has joined and flushed its sends, so the next day starts right away
+        last_date = current_date;
+        current_date = next_trading_date(calendar, current_date.addDays(1));
         total_days++;
 
-        if (current_date < end_date && keep_running) {
-            sleep_until_next_9am(); 
-        }
+    }
 
+    prefetcher.reset();
+    for (auto& shard : shards) {
+        close(shard->sock);
+    }
+
+    if (!stream_path.empty()) {
+        cout << "\nStreamed " << stream.reader().bytes_read() / (1 << 20) << " MiB, " << stream.records() << " records";
+        if (stream.out_of_order() || stream.malformed()) {
+            cout << " (dropped " << stream.out_of_order() << " out of order, " << stream.malformed() << " malformed)";
+        }
+        cout << "\n";
     }
 
     if (keep_running) {
@@ -386,7 +1283,7 @@ int main(int argc, char* argv[]) {
         cout << "Date range: " << start_date.toString() << " to " << end_date.toString() << "\n";
     } else {
         cout << "\n=== SIMULATION INTERRUPTED ===\n";
-        cout << "Last processed date: " << current_date.addDays(-1).toString() << "\n";
+        cout << "Last processed date: " << last_date.toString() << "\n";
     }
 
     return 0;
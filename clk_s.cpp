@@ -9,6 +9,17 @@
 #include <thread>
 #include <cstring>
 #include <sstream>
+#include <climits>
+#include <cstdlib>
+#include <tuple>
+#include <new>
+
+#include "tick_ring.h"
+#include "control_plane.h"
+#include "civil_date.h"
+#include "trading_calendar.h"
+#include "replay_image.h"
+#include "pacer.h"
 
 using namespace std;
 
@@ -18,85 +29,26 @@ constexpr uint64_t END_TIME_SEC = 15 * 3600 + 30 * 60;
 constexpr uint64_t TOTAL_SECONDS = END_TIME_SEC - START_TIME_SEC;
 volatile constexpr uint64_t TOTAL_JIFFIES = TOTAL_SECONDS * JIFFIES_PER_SEC;
 
-// Ring buffer size - must be power of 2
-constexpr size_t RING_SIZE = 3*JIFFIES_PER_SEC;  // 64K entries
-// volatile constexpr size_t RING_MASK = 3*JIFFIES_PER_SEC - 1;
-
 volatile bool keep_running = true;
 
-struct DateConfig {
-    char start_date[12];  // "YYYY-MM-DD\0"
-    char end_date[12];    // "YYYY-MM-DD\0"
-};
-
-// Simple tick event
-struct TickEvent {
-    uint64_t tick_number;
-    uint64_t timestamp_ns;
-};
-
-// Simplified shared structure
-struct SharedRingBuffer {
-    // Control flags
-    atomic<bool> producer_running;
-    atomic<bool> producer_finished;
-    atomic<uint64_t> total_generated;
-    atomic<uint64_t> dropped_count;
-    atomic<uint64_t> head;
-    atomic<uint64_t> tail;
-    char padding[64];
-    
-    SharedRingBuffer() {
-        producer_running.store(false, memory_order_relaxed);
-        producer_finished.store(false, memory_order_relaxed);
-        total_generated.store(0, memory_order_relaxed);
-        dropped_count.store(0, memory_order_relaxed);
-        head.store(0, memory_order_relaxed);
-        tail.store(0, memory_order_relaxed);
-    }
-    // Ring buffer data
-    // TickEvent events[RING_SIZE];
-};
-
 struct Date {
     int year, month, day;
     
     Date(int y, int m, int d) : year(y), month(m), day(d) {}
     
-    // Convert to days since epoch (1970-01-01)
+    // Days since epoch (1970-01-01)
     int toDaysSinceEpoch() const {
-        struct tm tm = {};
-        tm.tm_year = year - 1900;
-        tm.tm_mon = month - 1;
-        tm.tm_mday = day;
-        tm.tm_hour = 0;
-        tm.tm_min = 0;
-        tm.tm_sec = 0;
-        tm.tm_isdst = -1;
-        
-        time_t time = mktime(&tm);
-        return time / (24 * 3600);
+        return static_cast<int>(days_from_civil(year, month, day));
     }
     
     // Add days to current date
     Date addDays(int days) const {
-        struct tm tm = {};
-        tm.tm_year = year - 1900;
-        tm.tm_mon = month - 1;
-        tm.tm_mday = day + days;
-        tm.tm_hour = 0;
-        tm.tm_min = 0;
-        tm.tm_sec = 0;
-        tm.tm_isdst = -1;
-        
-        time_t time = mktime(&tm);
-        struct tm* result = localtime(&time);
-        
-        return Date(result->tm_year + 1900, result->tm_mon + 1, result->tm_mday);
+        CivilDate c = civil_from_days(days_from_civil(year, month, day) + days);
+        return Date(c.year, static_cast<int>(c.month), static_cast<int>(c.day));
     }
     
     bool operator<=(const Date& other) const {
-        return toDaysSinceEpoch() <= other.toDaysSinceEpoch();
+        return tie(year, month, day) <= tie(other.year, other.month, other.day);
     }
     
     string toString() const {
@@ -116,7 +68,7 @@ Date parseDate(const string& dateStr) {
         throw invalid_argument("Invalid date format. Use YYYY-MM-DD");
     }
     
-    if (month < 1 || month > 12 || day < 1 || day > 31) {
+    if (!valid_civil(year, month, day)) {
         throw invalid_argument("Invalid date values");
     }
     
@@ -125,41 +77,26 @@ Date parseDate(const string& dateStr) {
 
 // Get number of jiffies from Jan 1, 1980 to virtual today 9:00 AM
 uint64_t jiffies_from_1980_to_virtual_day(const Date& target_date) {
-    // Epoch: 1980-01-01 00:00:00
-    std::tm base_tm = {};
-    base_tm.tm_year = 1980 - 1900;
-    base_tm.tm_mon = 0;
-    base_tm.tm_mday = 1;
-    base_tm.tm_hour = 0;
-    base_tm.tm_min = 0;
-    base_tm.tm_sec = 0;
-    base_tm.tm_isdst = -1;
-    time_t base_time = mktime(&base_tm);
-
-    // Virtual 9:00 AM of target date
-    std::tm day_tm = {};
-    day_tm.tm_year = target_date.year - 1900;
-    day_tm.tm_mon = target_date.month - 1;
-    day_tm.tm_mday = target_date.day;
-    day_tm.tm_hour = 9;
-    day_tm.tm_min = 0;
-    day_tm.tm_sec = 0;
-    day_tm.tm_isdst = -1;
-    time_t day_time = mktime(&day_tm);
-
-    return static_cast<uint64_t>(day_time - base_time) * JIFFIES_PER_SEC;
+    return civil_to_jiffies(target_date.year, target_date.month, target_date.day, 9);
 }
 
-
-void sleep_until_next_9am() {
-    cout << "[INFO] Sleeping until next market day...\n";
-    this_thread::sleep_for(chrono::seconds(100)); 
+// First trading day on or after `date`
+Date next_trading_date(const TradingCalendar& calendar, const Date& date) {
+    int64_t days = days_from_civil(date.year, date.month, date.day);
+    return date.addDays(static_cast<int>(calendar.next_trading_day(days) - days));
 }
 
+
 void printUsage(const char* program_name) {
-    cout << "Usage: " << program_name << " <start_date> <end_date>\n";
+    cout << "Usage: " << program_name << " <start_date> <end_date> [replay_image] [--consumers N] [--speed X] [--holidays F]\n";
     cout << "Date format: YYYY-MM-DD\n";
-    cout << "Example: " << program_name << " 2024-09-02 2024-09-30\n";
+    cout << "Example: " << program_name << " 2024-09-02 2024-09-30 Data/sorted_filtered_data5.img --consumers 3\n";
+    cout << "With a replay image, each tick carries that jiffy's records to the emitters\n";
+    cout << "Only trading days are generated: weekdays not listed in the holiday file F (default holidays.txt)\n";
+    cout << "Generation starts once N emitters (default 2, at most " << MAX_CONSUMERS << ") have attached to " << TICK_RING_SHM << "\n";
+    cout << "--speed X replays at X times real time (1 = real time, default 0 = as fast as possible)\n";
+    cout << "Each emitter picks its own backpressure policy (--policy); spin and futex emitters never miss a tick\n";
+    cout << "--sample-latency N stamps every Nth tick so emitters report generator-to-emitter latency (default 0 = off)\n";
 }
 
 void handle_sigint(int) {
@@ -170,7 +107,7 @@ int main(int argc, char* argv[]) {
     signal(SIGINT, handle_sigint);
 
     // Parse command line arguments
-    if (argc != 3) {
+    if (argc < 3) {
         printUsage(argv[0]);
         return 1;
     }
@@ -187,6 +124,37 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    string image_path;
+    size_t consumers = 2;
+    uint64_t factor = 0;      // 0 = as fast as possible, otherwise replay speed (1 = real time)
+    uint64_t sample_every = 0;
+    string holidays_file = "holidays.txt";
+    bool holidays_given = false;
+
+    try {
+        for (int a = 3; a < argc; a++) {
+            string arg = argv[a];
+            if (arg == "--speed" && a + 1 < argc) {
+                factor = stoull(argv[++a]);
+            } else if (arg == "--sample-latency" && a + 1 < argc) {
+                sample_every = stoull(argv[++a]);
+            } else if (arg == "--holidays" && a + 1 < argc) {
+                holidays_file = argv[++a];
+                holidays_given = true;
+            } else if (arg == "--consumers" && a + 1 < argc) {
+                consumers = stoul(argv[++a]);
+                if (consumers == 0 || consumers > MAX_CONSUMERS) throw invalid_argument(arg);
+            } else if (arg.rfind("--", 0) != 0 && image_path.empty()) {
+                image_path = arg;
+            } else {
+                throw invalid_argument(arg);
+            }
+        }
+    } catch (...) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
     if (!(start_date <= end_date)) {
         cerr << "Error: Start date must be before or equal to end date\n";
         return 1;
@@ -195,21 +163,46 @@ int main(int argc, char* argv[]) {
     cout << "Starting tick generation from " << start_date.toString() 
          << " to " << end_date.toString() << endl;
 
-    Date current_date = start_date;
+    TradingCalendar calendar;
+    string calendar_error;
+    if (calendar.load(holidays_file, calendar_error)) {
+        char resolved[PATH_MAX];
+        if (realpath(holidays_file.c_str(), resolved)) holidays_file = resolved;
+        cout << "Trading calendar: " << calendar.holidays() << " holidays from " << holidays_file << "\n";
+    } else if (holidays_given) {
+        cerr << "Error: " << calendar_error << "\n";
+        return 1;
+    } else {
+        holidays_file.clear();
+        cout << "Trading calendar: no holiday file, trading every weekday\n";
+    }
+
+    ReplayImage image;
+    if (!image_path.empty()) {
+        string error;
+        if (!image.open(image_path, error)) {
+            cerr << "Error: " << error << "\n";
+            return 1;
+        }
+        cout << "Replaying " << image.view().record_count << " records from " << image_path << "\n";
+    }
+    const ReplayView& records = image.view();
+
+    Date current_date = next_trading_date(calendar, start_date);
+    Date last_date = current_date;
     int total_days = 0;
 
-    const char* shm_name1 = "/simple_ring_buffer1";
-    const char* shm_name2 = "/simple_ring_buffer2";
-    const char* shm_config_name = "/date_config";
+    const char* shm_name = TICK_RING_SHM;
+    const char* shm_config_name = CONTROL_PLANE_SHM;
 
-    // Create date config shared memory
+    // Control segment: run descriptor and live state; emitters check it before the ring
     int config_fd = shm_open(shm_config_name, O_CREAT | O_RDWR, 0666);
     if (config_fd < 0) {
         perror("shm_open config failed");
         return 1;
     }
     
-    size_t config_size = sizeof(DateConfig);
+    size_t config_size = sizeof(ControlPlane);
     if (ftruncate(config_fd, config_size) < 0) {
         perror("ftruncate config failed");
         close(config_fd);
@@ -217,103 +210,93 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    auto* date_config = static_cast<DateConfig*>(
+    auto* control = static_cast<ControlPlane*>(
         mmap(nullptr, config_size, PROT_READ | PROT_WRITE, MAP_SHARED, config_fd, 0)
     );
     
-    if (date_config == MAP_FAILED) {
+    if (control == MAP_FAILED) {
         perror("mmap config failed");
         close(config_fd);
         shm_unlink(shm_config_name);
         return 1;
     }
 
-    // Initialize and send date config
-    memset(date_config, 0, sizeof(DateConfig));
-    strcpy(date_config->start_date, start_date.toString().c_str());
-    strcpy(date_config->end_date, end_date.toString().c_str());
-    
-    cout << "Date config sent to emitters via separate shared memory:\n";
-    cout << "  Start: " << date_config->start_date << "\n";
-    cout << "  End: " << date_config->end_date << "\n";
-
-    // Ring buffers
-    int fd1 = shm_open(shm_name1, O_CREAT | O_RDWR, 0666);
-    if (fd1 < 0) {
-        perror("shm_open1 failed");
-        return 1;
-    }
-    int fd2 = shm_open(shm_name2, O_CREAT | O_RDWR, 0666);
-    if (fd2 < 0) {
-        perror("shm_open2 failed");
+    // Describe the run; it stays invisible to emitters until control->open(). Value-initialized
+    // in place: zero magic, zero seqlock, empty registry.
+    control = new (control) ControlPlane{};
+    control->run.start_days = start_date.toDaysSinceEpoch();
+    control->run.end_days = end_date.toDaysSinceEpoch();
+    control->run.speed = factor;
+    control->run.sample_every = sample_every;
+    control->run.consumers = static_cast<uint32_t>(consumers);
+    snprintf(control->run.holidays_file, sizeof(control->run.holidays_file), "%s", holidays_file.c_str());
+    control->describe_ring();
+    control->publish(0, PHASE_ATTACHING, control->run.start_days, 0, 0);
+
+    // Broadcast ring, read by every emitter through its own cursor
+    int fd = shm_open(shm_name, O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        perror("shm_open failed");
         return 1;
     }
     
     size_t shm_size = sizeof(SharedRingBuffer);
-    if (ftruncate(fd1, shm_size) < 0) {
+    if (ftruncate(fd, shm_size) < 0) {
         perror("ftruncate failed");
-        close(fd1);
-        shm_unlink(shm_name1);
-        return 1;
-    }
-    if (ftruncate(fd2, shm_size) < 0) {
-        perror("ftruncate failed");
-        close(fd2);
-        shm_unlink(shm_name2);
+        close(fd);
+        shm_unlink(shm_name);
         return 1;
     }
     
-    auto* ring1 = static_cast<SharedRingBuffer*>(
-        mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd1, 0)
-    );
-    auto* ring2 = static_cast<SharedRingBuffer*>(
-        mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd2, 0)
+    auto* ring = static_cast<SharedRingBuffer*>(
+        mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
     );
     
-    if (ring1 == MAP_FAILED) {
-        perror("mmap1 failed");
-        close(fd1);
-        shm_unlink(shm_name1);
-        return 1;
-    }
-    if (ring2 == MAP_FAILED) {
-        perror("mmap2 failed");
-        close(fd2);
-        shm_unlink(shm_name2);
+    if (ring == MAP_FAILED) {
+        perror("mmap failed");
+        close(fd);
+        shm_unlink(shm_name);
         return 1;
     }
 
-    // Initialize shared memory
-    memset(ring1, 0, sizeof(SharedRingBuffer));
-    memset(ring2, 0, sizeof(SharedRingBuffer));
+    // Construct the ring in place over whatever an earlier run left in the segment
+    ring = new (ring) SharedRingBuffer();
+    control->open();
     
-    cout << "Simple Ring Buffer Generator ready. Buffer size: " << RING_SIZE << " events\n";
+    cout << "Run published to " << shm_config_name << " (control plane v" << CONTROL_PLANE_VERSION << "):\n";
+    cout << "  Start: " << start_date.toString() << "\n";
+    cout << "  End: " << end_date.toString() << "\n";
+    cout << "Broadcast Ring Buffer Generator ready. Buffer size: " << RING_SIZE << " events\n";
     cout << "Shared memory size: " << shm_size << " bytes\n";
-    cout << "Waiting 10 seconds for receiver...\n";
-    sleep(10);
+    cout << "Waiting for " << consumers << " receivers to attach...\n";
+    while (keep_running && ring->events.active_consumers() < consumers) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        control->heartbeat();
+    }
+    cout << ring->events.active_consumers() << " receivers attached\n";
 
-    volatile uint64_t factor = 1;
     uint64_t tick_count = 0;
     uint64_t successful_writes = 0;
     uint64_t dropped = 0;
-    
+    uint32_t session = 0;
+
+    // Latency sampling: the stamp is the same counter the emitters read, so they can subtract
+    const TscClock& tsc = TscClock::instance();
+    uint64_t sample_countdown = sample_every;
+    if (sample_every) {
+        cout << "Latency sampling: every " << sample_every << " ticks, "
+             << (tsc.invariant_tsc() ? "invariant TSC at " : "CLOCK_MONOTONIC at ") << tsc.ticks_per_sec() << " Hz\n";
+    }
 
     while(current_date <= end_date && keep_running){
 
-        // Reset buffers for new day using relaxed atomic operations
-        ring1->head.store(0, memory_order_relaxed);
-        ring1->tail.store(0, memory_order_relaxed);
-        ring1->total_generated.store(0, memory_order_relaxed);
-        ring1->dropped_count.store(0, memory_order_relaxed);
-        ring1->producer_running.store(false, memory_order_relaxed);
-        ring1->producer_finished.store(false, memory_order_relaxed);
-        
-        ring2->head.store(0, memory_order_relaxed);
-        ring2->tail.store(0, memory_order_relaxed);
-        ring2->total_generated.store(0, memory_order_relaxed);
-        ring2->dropped_count.store(0, memory_order_relaxed);
-        ring2->producer_running.store(false, memory_order_relaxed);
-        ring2->producer_finished.store(false, memory_order_relaxed);
+        // Every receiver acknowledged the previous day, so all are parked: open the next
+        // session where the last one ended
+        session++;
+        ring->total_generated.store(0, memory_order_relaxed);
+        ring->dropped_count.store(0, memory_order_relaxed);
+        control->publish(session, PHASE_RUNNING, current_date.toDaysSinceEpoch(), 0, 0);
+        ring->start_day(session);
 
         tick_count = 0;
         successful_writes = 0;
@@ -322,106 +305,100 @@ int main(int argc, char* argv[]) {
         uint64_t ticks = jiffies_from_1980_to_virtual_day(current_date);
         
         cout << "Jiffies before today start: " << ticks << endl;
-        cout << "Starting tick generation for " << current_date.toString() << "...\n";
+        cout << "Starting tick generation for " << current_date.toString() << " (session " << session << ")...\n";
 
-        ring1->producer_running.store(true, memory_order_relaxed);
-        ring2->producer_running.store(true, memory_order_relaxed);
-        
+        // Per-receiver backpressure counters are cumulative; report each day's share
+        ConsumerCounters day_start[MAX_CONSUMERS];
+        for (size_t i = 0; i < MAX_CONSUMERS; i++) day_start[i] = ring->counters(i);
+
+        Pacer pacer(factor, JIFFIES_PER_SEC);
         auto start_time = chrono::high_resolution_clock::now();
 
-        // Simple ring buffer logic with relaxed atomics
-        if(factor == 0) {
-            // Maximum speed
-            while(keep_running && tick_count < TOTAL_JIFFIES) {
-                // Load current values with relaxed ordering for maximum performance
-                uint64_t head1 = ring1->head.load(memory_order_relaxed);
-                uint64_t tail1 = ring1->tail.load(memory_order_relaxed);
-                uint64_t head2 = ring2->head.load(memory_order_relaxed);
-                uint64_t tail2 = ring2->tail.load(memory_order_relaxed);
-                
-                bool buffer_1_has_space = (head1 + 1) % RING_SIZE != tail1;
-                bool buffer_2_has_space = (head2 + 1) % RING_SIZE != tail2;
-
-                if (buffer_1_has_space && buffer_2_has_space) {
-                    // Get timestamp once (commented out for performance)
-                    // auto now = chrono::high_resolution_clock::now();
-                    // uint64_t timestamp = chrono::duration_cast<chrono::nanoseconds>(
-                    //     now.time_since_epoch()).count();
-                    
-                    // Write to buffer A
-                    // size_t index_1 = head1 % RING_SIZE;
-                    // ring1->events[index_1].tick_number = tick_count;
-                    // ring1->events[index_1].timestamp_ns = timestamp;
-                    ring1->head.store((head1 + 1) % RING_SIZE, memory_order_relaxed);
-                    
-                    // Write to buffer B  
-                    // size_t index_2 = head2 % RING_SIZE;
-                    // ring2->events[index_2].tick_number = tick_count;
-                    // ring2->events[index_2].timestamp_ns = timestamp;
-                    ring2->head.store((head2 + 1) % RING_SIZE, memory_order_relaxed);
-                    
-                    successful_writes++;
-                } else {
-                    // One or both buffers full
+        // Records of the day, visited in step with the ticks
+        const JiffyIndexEntry* rec_it = records.lower_bound(ticks);
+        uint64_t records_sent = 0;
+        uint64_t oversized_jiffies = 0;
+        uint64_t oversized_records = 0;
+
+        // Publish one tick, with its jiffy's records in the slab, or count it as dropped
+        auto generate_tick = [&]() {
+            uint64_t jiffy = ticks + tick_count;
+            const JiffyIndexEntry* batch = nullptr;
+            if (rec_it != records.end() && rec_it->jiffy == jiffy) {
+                batch = rec_it++;
+            }
+
+            // Waits for spin/futex receivers a full ring behind; drop/conflate ones get lapped
+            auto slot = ring->claim_event(keep_running);
+
+            if (!slot.count) {
+                // Stopped while waiting for a receiver
+                dropped++;
+                return;
+            }
+
+            TickEvent event{jiffy, 0, ring->slab_position(), 0, 0};
+            if (batch && records.bytes(*batch) > SLAB_SIZE) {
+                // More records than the whole slab holds can never be sent; the tick still goes
+                // out, bare, and the jiffy is reported
+                oversized_jiffies++;
+                oversized_records += batch->record_count;
+                cerr << "Warning: jiffy " << jiffy << " has " << records.bytes(*batch) << " bytes of records, more than the "
+                     << SLAB_SIZE << "-byte slab; sending the tick without them\n";
+            } else if (batch) {
+                size_t bytes = records.bytes(*batch);
+                if (!ring->slab_write(records.records(*batch), bytes, event.payload_offset, keep_running)) {
+                    // The batch fits, so this only fails once keep_running was cleared while
+                    // waiting for slab room
                     dropped++;
+                    return;
                 }
+                event.payload_size = static_cast<uint32_t>(bytes);
+                event.record_count = batch->record_count;
+                records_sent += batch->record_count;
+            }
+
+            // Every Nth tick carries a counter stamp for the emitters' latency histograms; the
+            // rest only pay for the countdown
+            if (sample_every && --sample_countdown == 0) {
+                sample_countdown = sample_every;
+                event.timestamp_tsc = tsc.now();
+            }
+
+            // Written once, seen by every receiver; wakes any that parked
+            slot.data[0] = event;
+            ring->publish();
+
+            successful_writes++;
 
+            // Live state for the control plane, once per simulated second
+            if ((tick_count & (JIFFIES_PER_SEC - 1)) == 0) {
+                control->publish(session, PHASE_RUNNING, current_date.toDaysSinceEpoch(), tick_count, records_sent);
+            }
+        };
+
+        pacer.start();
+        if(factor == 0) {
+            // Maximum speed
+            while(keep_running && tick_count < TOTAL_JIFFIES) {
+                generate_tick();
                 tick_count++;
             }
         } else {
-            // Throttled generation
+            // Paced generation: each tick is due at an absolute TSC deadline for <factor>x
             while(keep_running && tick_count < TOTAL_JIFFIES) {
-                // Load current values with relaxed ordering
-                uint64_t head1 = ring1->head.load(memory_order_relaxed);
-                uint64_t tail1 = ring1->tail.load(memory_order_relaxed);
-                uint64_t head2 = ring2->head.load(memory_order_relaxed);
-                uint64_t tail2 = ring2->tail.load(memory_order_relaxed);
-                
-                bool buffer_1_has_space = (head1 + 1) % RING_SIZE != tail1;
-                bool buffer_2_has_space = (head2 + 1) % RING_SIZE != tail2;
-
-                if (buffer_1_has_space && buffer_2_has_space) {
-                    // Get timestamp once (commented out for performance)
-                    // auto now = chrono::high_resolution_clock::now();
-                    // uint64_t timestamp = chrono::duration_cast<chrono::nanoseconds>(
-                    //     now.time_since_epoch()).count();
-                    
-                    // Write to buffer A
-                    // size_t index_1 = head1 % RING_SIZE;
-                    // ring1->events[index_1].tick_number = tick_count;
-                    // ring1->events[index_1].timestamp_ns = timestamp;
-                    ring1->head.store((head1 + 1) % RING_SIZE, memory_order_relaxed);
-                    
-                    // Write to buffer B  
-                    // size_t index_2 = head2 % RING_SIZE;
-                    // ring2->events[index_2].tick_number = tick_count;
-                    // ring2->events[index_2].timestamp_ns = timestamp;
-                    ring2->head.store((head2 + 1) % RING_SIZE, memory_order_relaxed);
-                    
-                    successful_writes++;
-                } else {
-                    // One or both buffers full
-                    dropped++;
-                }
-
+                pacer.wait(tick_count);
+                generate_tick();
                 tick_count++;
-
-                // Throttling delay
-                volatile uint64_t i = 0;
-                while(i < factor) { ++i; }
             }
         }
 
         auto end_time = chrono::high_resolution_clock::now();
         
         // Update final statistics with relaxed atomics
-        ring1->total_generated.store(tick_count, memory_order_relaxed);
-        ring1->dropped_count.store(dropped, memory_order_relaxed);
-        ring1->producer_finished.store(true, memory_order_relaxed);
-
-        ring2->total_generated.store(tick_count, memory_order_relaxed);
-        ring2->dropped_count.store(dropped, memory_order_relaxed);
-        ring2->producer_finished.store(true, memory_order_relaxed);
+        ring->total_generated.store(tick_count, memory_order_relaxed);
+        ring->dropped_count.store(dropped, memory_order_relaxed);
+        ring->finish();
         
         auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
         double seconds = elapsed_ms / 1000.0;
@@ -432,6 +409,8 @@ int main(int argc, char* argv[]) {
         cout << "Total Ticks Generated:    " << tick_count << "\n";
         cout << "Successful Buffer Writes: " << successful_writes << "\n";
         cout << "Dropped Events:           " << dropped << "\n";
+        cout << "Records Published:        " << records_sent << "\n";
+        cout << "Oversized Jiffies:        " << oversized_jiffies << " (" << oversized_records << " records not sent)\n";
         cout << "Drop Rate:                " << (100.0 * dropped / tick_count) << "%\n";
         cout << "Elapsed Time:             " << seconds << " sec\n";
         cout << "Simulated Time:           " << sim_seconds << " sec\n";
@@ -439,45 +418,39 @@ int main(int argc, char* argv[]) {
         cout << "Buffer Write Rate:        " << (successful_writes / seconds) << " events/sec\n";
         cout << "Time Speedup Factor:      " << (sim_seconds / seconds) << "x\n";
 
-        // Reset buffers for new day - Second reset (you had this duplicated)
-        ring1->head.store(0, memory_order_relaxed);
-        ring1->tail.store(0, memory_order_relaxed);
-        ring1->total_generated.store(0, memory_order_relaxed);
-        ring1->dropped_count.store(0, memory_order_relaxed);
-        ring1->producer_running.store(false, memory_order_relaxed);
-        ring1->producer_finished.store(false, memory_order_relaxed);
-        
-        ring2->head.store(0, memory_order_relaxed);
-        ring2->tail.store(0, memory_order_relaxed);
-        ring2->total_generated.store(0, memory_order_relaxed);
-        ring2->dropped_count.store(0, memory_order_relaxed);
-        ring2->producer_running.store(false, memory_order_relaxed);
-        ring2->producer_finished.store(false, memory_order_relaxed);
+        for (size_t i = 0; i < MAX_CONSUMERS; i++) {
+            if (!ring->events.active(i)) continue;
+            ConsumerCounters now = ring->counters(i);
+            cout << "Receiver " << i << " (" << policy_name(ring->consumers[i].policy.load(memory_order_relaxed))
+                 << ", pid " << control->consumers[i].pid.load(memory_order_acquire) << "):\n";
+            cout << "  Dropped:                " << (now.dropped - day_start[i].dropped) << "\n";
+            cout << "  Conflated:              " << (now.conflated - day_start[i].conflated) << "\n";
+            cout << "  Producer Stalls:        " << (now.stalls - day_start[i].stalls) << "\n";
+            cout << "  Stall Time:             " << (now.stall_ns - day_start[i].stall_ns) / 1e6 << " ms\n";
+        }
 
-        tick_count = 0;
-        successful_writes = 0;
-        dropped = 0;
+        // Day boundary: the next day starts as soon as every receiver has drained this one
+        control->publish(session, PHASE_DRAINING, current_date.toDaysSinceEpoch(), tick_count, records_sent);
+        auto drain_start = chrono::steady_clock::now();
+        bool drained = ring->wait_for_acks(session, keep_running, [&] { control->heartbeat(); });
+        auto drain_ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - drain_start).count() / 1000.0;
+        cout << "Receivers Drained:        " << (drained ? "yes" : "no (interrupted)") << " after " << drain_ms << " ms\n";
 
-        current_date = current_date.addDays(1);
+        // Weekends and holidays are skipped outright: no ticks, no wait
+        last_date = current_date;
+        current_date = next_trading_date(calendar, current_date.addDays(1));
         total_days++;
-        
-        if (current_date <= end_date && keep_running) {
-            sleep_until_next_9am(); 
-        }
     }
 
     // Cleanup
-    munmap(date_config, config_size);
+    control->publish(session, PHASE_DONE, last_date.toDaysSinceEpoch(), 0, 0);
+    munmap(control, config_size);
     close(config_fd);
     shm_unlink(shm_config_name);
     
-    munmap(ring1, shm_size);
-    close(fd1);
-    shm_unlink(shm_name1);
-
-    munmap(ring2, shm_size);
-    close(fd2);
-    shm_unlink(shm_name2);
+    munmap(ring, shm_size);
+    close(fd);
+    shm_unlink(shm_name);
 
     if (keep_running) {
         cout << "\n=== SIMULATION COMPLETE ===\n";
@@ -485,7 +458,7 @@ int main(int argc, char* argv[]) {
         cout << "Date range: " << start_date.toString() << " to " << end_date.toString() << "\n";
     } else {
         cout << "\n=== SIMULATION INTERRUPTED ===\n";
-        cout << "Last processed date: " << current_date.addDays(-1).toString() << "\n";
+        cout << "Last processed date: " << last_date.toString() << "\n";
     }
 
     return 0;
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "tick_ring.h"
+
+// Control segment the clk_s generator publishes next to the tick ring. It replaces the old
+// /date_config strings with a versioned, binary description of the run:
+//
+//   header   magic and layout version, stored last so a reader never sees a half-written run
+//   run      the run descriptor: date range, speed, holiday file and the ring's geometry,
+//            written once before the header
+//   live     what the generator is doing right now, published through a seqlock
+//   registry one entry per ring cursor, filled in by the emitter that holds it
+//
+// An emitter maps this first and checks it against its own build with compatible(), so a
+// generator built with a different ring layout is refused at attach instead of misread.
+
+constexpr const char* CONTROL_PLANE_SHM = "/tick_control";
+constexpr uint64_t CONTROL_PLANE_MAGIC = 0x314C54434B434954ULL;    // "TICKCTL1"
+constexpr uint32_t CONTROL_PLANE_VERSION = 2;      // 2: sample_every
+constexpr uint64_t CONTROL_HEARTBEAT_NS = 100000000;       // heartbeat period while the generator waits
+constexpr uint64_t CONTROL_STALE_NS = 5000000000ULL;       // a waiting generator this quiet is gone
+
+// Single-writer seqlock over a trivially copyable T. The value is kept in relaxed atomic
+// words, so a reader that races the writer gets a torn copy it then throws away rather than
+// a data race; the sequence is odd while a write is in progress.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+    static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+public:
+    void store(const T& value) {
+        uint64_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+        uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) words_[i].store(words[i], std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    T load() const {
+        uint64_t words[WORDS];
+        for (;;) {
+            uint32_t before = seq_.load(std::memory_order_acquire);
+            if (before & 1) {
+                cpu_relax();
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; i++) words[i] = words_[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq_.load(std::memory_order_relaxed) == before) break;
+        }
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<uint32_t> seq_;
+    std::atomic<uint64_t> words_[WORDS];
+};
+
+struct ControlHeader {
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t segment_bytes;            // sizeof(ControlPlane)
+};
+
+struct RunDescriptor {
+    int64_t start_days;                // first date, days since 1970-01-01
+    int64_t end_days;                  // last date, inclusive
+    uint64_t speed;                    // times real time, 0 = as fast as possible
+    uint64_t sample_every;             // every Nth tick carries a TscClock stamp, 0 = no sampling
+    uint32_t consumers;                // receivers the generator waits for before day 1
+    uint32_t max_consumers;
+    uint64_t ring_size;                // events
+    uint64_t slab_size;                // bytes
+    uint64_t event_bytes;              // sizeof(TickEvent)
+    uint64_t ring_bytes;               // sizeof(SharedRingBuffer)
+    char ring_shm[64];
+    char holidays_file[256];           // absolute path, empty for weekdays only
+};
+
+enum RunPhase : uint32_t {
+    PHASE_ATTACHING = 0,               // waiting for receivers
+    PHASE_RUNNING = 1,                 // generating day `session`
+    PHASE_DRAINING = 2,                // day generated, waiting for every receiver's ack
+    PHASE_DONE = 3                     // finished or interrupted
+};
+
+inline const char* phase_name(uint32_t phase) {
+    switch (phase) {
+        case PHASE_ATTACHING: return "attaching";
+        case PHASE_RUNNING: return "running";
+        case PHASE_DRAINING: return "draining";
+        case PHASE_DONE: return "done";
+    }
+    return "unknown";
+}
+
+struct LiveState {
+    uint32_t session;                  // day number, as in the tick ring
+    uint32_t phase;
+    int64_t date_days;                 // trading day of the session, days since 1970-01-01
+    uint64_t ticks;                    // ticks generated so far today
+    uint64_t records;                  // records published so far today
+    uint64_t heartbeat_ns;             // steady clock of the update, refreshed while the generator
+                                       // waits for receivers to attach or acknowledge
+};
+
+// Registry entry of one ring cursor, indexed like it; pid 0 marks it free
+struct ConsumerRecord {
+    std::atomic<uint32_t> pid;
+    std::atomic<uint32_t> policy;
+    std::atomic<uint64_t> attached_ns;
+};
+
+inline uint64_t control_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct ControlPlane {
+    ControlHeader header;
+    RunDescriptor run;
+    alignas(64) Seqlock<LiveState> live;
+    alignas(64) ConsumerRecord consumers[MAX_CONSUMERS];
+
+    // Generator: fill in the geometry of this build; the caller adds the run itself
+    void describe_ring() {
+        run.max_consumers = MAX_CONSUMERS;
+        run.ring_size = RING_SIZE;
+        run.slab_size = SLAB_SIZE;
+        run.event_bytes = sizeof(TickEvent);
+        run.ring_bytes = sizeof(SharedRingBuffer);
+        snprintf(run.ring_shm, sizeof(run.ring_shm), "%s", TICK_RING_SHM);
+    }
+
+    // Generator: make the run visible, once the descriptor and the ring are in place
+    void open() {
+        header.version = CONTROL_PLANE_VERSION;
+        header.segment_bytes = sizeof(ControlPlane);
+        header.magic.store(CONTROL_PLANE_MAGIC, std::memory_order_release);
+    }
+
+    void publish(uint32_t session, RunPhase phase, int64_t date_days, uint64_t ticks, uint64_t records) {
+        live.store(LiveState{session, phase, date_days, ticks, records, control_clock_ns()});
+    }
+
+    // Generator: restamp the live state while waiting; cheap to call from a polling loop, it
+    // only stores once CONTROL_HEARTBEAT_NS have passed
+    void heartbeat() {
+        LiveState state = live.load();
+        uint64_t now = control_clock_ns();
+        if (now - state.heartbeat_ns < CONTROL_HEARTBEAT_NS) return;
+        state.heartbeat_ns = now;
+        live.store(state);
+    }
+
+    // Emitter: how long ago the generator last published `state`
+    static uint64_t heartbeat_age_ns(const LiveState& state) {
+        uint64_t now = control_clock_ns();
+        return now > state.heartbeat_ns ? now - state.heartbeat_ns : 0;
+    }
+
+    // Emitter: false, with the reason, unless the generator runs a layout this build can read
+    bool compatible(std::string& error) const {
+        if (header.magic.load(std::memory_order_acquire) != CONTROL_PLANE_MAGIC) {
+            error = "no run published yet (generator still starting?)";
+            return false;
+        }
+        if (header.version != CONTROL_PLANE_VERSION || header.segment_bytes != sizeof(ControlPlane)) {
+            error = "control plane version " + std::to_string(header.version) + " (" +
+                    std::to_string(header.segment_bytes) + " bytes), this build reads version " +
+                    std::to_string(CONTROL_PLANE_VERSION) + " (" + std::to_string(sizeof(ControlPlane)) + " bytes)";
+            return false;
+        }
+        if (run.max_consumers != MAX_CONSUMERS || run.ring_size != RING_SIZE || run.slab_size != SLAB_SIZE ||
+            run.event_bytes != sizeof(TickEvent) || run.ring_bytes != sizeof(SharedRingBuffer)) {
+            error = "generator ring is " + std::to_string(run.ring_size) + " events x " +
+                    std::to_string(run.event_bytes) + " bytes, slab " + std::to_string(run.slab_size) +
+                    ", " + std::to_string(run.max_consumers) + " consumers, " + std::to_string(run.ring_bytes) +
+                    " bytes in all; this build expects " + std::to_string(RING_SIZE) + " x " +
+                    std::to_string(sizeof(TickEvent)) + ", slab " + std::to_string(SLAB_SIZE) + ", " +
+                    std::to_string(MAX_CONSUMERS) + " consumers, " + std::to_string(sizeof(SharedRingBuffer));
+            return false;
+        }
+        return true;
+    }
+
+    // Emitter: claim the registry entry of the cursor it registered on the ring
+    void join(int id, uint32_t pid, BackpressurePolicy policy) {
+        ConsumerRecord& c = consumers[id];
+        c.policy.store(policy, std::memory_order_relaxed);
+        c.attached_ns.store(control_clock_ns(), std::memory_order_relaxed);
+        c.pid.store(pid, std::memory_order_release);
+    }
+
+    void leave(int id) {
+        consumers[id].pid.store(0, std::memory_order_release);
+    }
+};
@@ -0,0 +1,416 @@
+#include <iostream>
+#include <chrono>
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <cstring>
+#include <tuple>
+
+#include "tick_ring.h"
+#include "control_plane.h"
+#include "civil_date.h"
+#include "trading_calendar.h"
+#include "histogram.h"
+#include "pacer.h"
+
+using namespace std;
+
+constexpr uint64_t JIFFIES_PER_SEC = 1 << 16;
+
+volatile bool keep_running = true;
+uint64_t events_processed = 0;
+uint64_t records_received = 0;
+uint64_t payload_bytes = 0;
+uint64_t last_jiffy = 0;
+uint64_t parked_waits = 0;
+
+// Generator-to-emitter latency of sampled ticks, in counter ticks; clock is set only when the
+// generator samples
+const TscClock* latency_clock = nullptr;
+LogHistogram latency;
+
+// Date structure for easier handling
+struct Date {
+    int year, month, day;
+    
+    Date(int y, int m, int d) : year(y), month(m), day(d) {}
+    
+    // Days since epoch (1970-01-01)
+    int toDaysSinceEpoch() const {
+        return static_cast<int>(days_from_civil(year, month, day));
+    }
+    
+    // Add days to current date
+    Date addDays(int days) const {
+        CivilDate c = civil_from_days(days_from_civil(year, month, day) + days);
+        return Date(c.year, static_cast<int>(c.month), static_cast<int>(c.day));
+    }
+    
+    bool operator<=(const Date& other) const {
+        return tie(year, month, day) <= tie(other.year, other.month, other.day);
+    }
+    
+    string toString() const {
+        ostringstream oss;
+        oss << year << "-" << setfill('0') << setw(2) << month << "-" << setw(2) << day;
+        return oss.str();
+    }
+};
+
+Date dateFromDays(int64_t days) {
+    CivilDate c = civil_from_days(days);
+    return Date(c.year, static_cast<int>(c.month), static_cast<int>(c.day));
+}
+
+// Get number of jiffies from Jan 1, 1980 to virtual day 9:00 AM
+uint64_t jiffies_from_1980_to_virtual_day(const Date& target_date) {
+    return civil_to_jiffies(target_date.year, target_date.month, target_date.day, 9);
+}
+
+// First trading day on or after `date`
+Date next_trading_date(const TradingCalendar& calendar, const Date& date) {
+    int64_t days = days_from_civil(date.year, date.month, date.day);
+    return date.addDays(static_cast<int>(calendar.next_trading_day(days) - days));
+}
+
+// Map the generator's control segment and check it describes a run this build can read,
+// before touching the ring
+ControlPlane* attachControlPlane() {
+    const char* shm_config_name = CONTROL_PLANE_SHM;
+    
+    int config_fd = shm_open(shm_config_name, O_RDWR, 0666);
+    if (config_fd < 0) {
+        cerr << "Error: Unable to open control plane shared memory. Make sure generator is running first.\n";
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(config_fd, &st) < 0 || static_cast<size_t>(st.st_size) != sizeof(ControlPlane)) {
+        cerr << "Error: " << shm_config_name << " is " << st.st_size << " bytes, this build expects "
+             << sizeof(ControlPlane) << ". Generator built from another version?\n";
+        close(config_fd);
+        return nullptr;
+    }
+    
+    size_t config_size = sizeof(ControlPlane);
+    auto* control = static_cast<ControlPlane*>(
+        mmap(nullptr, config_size, PROT_READ | PROT_WRITE, MAP_SHARED, config_fd, 0)
+    );
+    close(config_fd);
+    
+    if (control == MAP_FAILED) {
+        cerr << "Error: Failed to map control plane shared memory.\n";
+        return nullptr;
+    }
+
+    string error;
+    if (!control->compatible(error)) {
+        cerr << "Error: Incompatible generator: " << error << "\n";
+        munmap(control, config_size);
+        return nullptr;
+    }
+    
+    LiveState live = control->live.load();
+    if (live.phase == PHASE_DONE) {
+        cerr << "Error: The generator's run has already finished.\n";
+        munmap(control, config_size);
+        return nullptr;
+    }
+
+    // While attaching or draining, a live generator restamps its heartbeat; while running it
+    // only publishes as ticks go out, so a receiver holding it back makes it quiet too
+    uint64_t quiet_ns = ControlPlane::heartbeat_age_ns(live);
+    if (quiet_ns > CONTROL_STALE_NS) {
+        if (live.phase != PHASE_RUNNING) {
+            cerr << "Error: No heartbeat from the generator for " << quiet_ns / 1000000000 << " s while "
+                 << phase_name(live.phase) << "; it looks gone. Restart it.\n";
+            munmap(control, config_size);
+            return nullptr;
+        }
+        cerr << "Warning: No progress from the generator for " << quiet_ns / 1000000000
+             << " s; it may be held back by a receiver, or gone.\n";
+    }
+
+    cout << "Run configuration received (control plane v" << control->header.version << "):\n";
+    cout << "  Start Date: " << dateFromDays(control->run.start_days).toString() << "\n";
+    cout << "  End Date: " << dateFromDays(control->run.end_days).toString() << "\n";
+    cout << "  Speed: " << control->run.speed << "x" << (control->run.speed ? "" : " (as fast as possible)") << "\n";
+    cout << "  Latency Sampling: " << (control->run.sample_every ? "every " + to_string(control->run.sample_every) + " ticks" : string("off")) << "\n";
+    cout << "  Generator: " << phase_name(live.phase) << ", session " << live.session << "\n";
+    return control;
+}
+
+void handle_sigint(int) {
+    keep_running = false;
+}
+
+// Your custom tick processing function
+inline void process_tick_event(const TickEvent& event, const RecordSpan& records) {
+    ++events_processed;
+    last_jiffy = event.tick_number;
+    // records.record(i) points at the i-th record of this jiffy, in place in shared memory
+    records_received += records.count;
+    payload_bytes += records.size;
+
+    // Sampled ticks carry the generator's counter stamp from just before it published them
+    if (event.timestamp_tsc && latency_clock) {
+        uint64_t now = latency_clock->now();
+        latency.record(now > event.timestamp_tsc ? now - event.timestamp_tsc : 0);
+    }
+}
+
+// Process every event published past our cursor. A blocking (spin/futex) receiver reads in
+// place and releases each contiguous span with a single tail store; a lossy (drop/conflate)
+// one may be lapped, so it works on validated copies instead.
+bool drain_ring(SharedRingBuffer* ring, int consumer_id, BackpressurePolicy policy) {
+    bool processed_events = false;
+    if (!policy_blocks(policy)) {
+        static EventCopy copy;
+        while (ring->read_copy(consumer_id, copy, 4096)) {
+            for (size_t i = 0; i < copy.size(); i++) {
+                process_tick_event(copy.events[i], copy.payload(i));
+            }
+            processed_events = true;
+        }
+        return processed_events;
+    }
+    for (auto span = ring->events.read(consumer_id); span.count; span = ring->events.read(consumer_id)) {
+        for (size_t i = 0; i < span.count; i++) {
+            process_tick_event(span.data[i], ring->payload(span.data[i]));
+        }
+        ring->release(consumer_id, span);
+        processed_events = true;
+    }
+    return processed_events;
+}
+
+void printUsage(const char* program_name) {
+    cout << "Usage: " << program_name << " [--name NAME] [--policy drop|spin|futex|conflate] [--spin-us N]\n";
+    cout << "Run one process per receiver; --name labels its output (default: its consumer id)\n";
+    cout << "What the generator does when this receiver falls a full ring behind (default drop):\n";
+    cout << "  drop      keep going; events it overwrites are skipped and counted as dropped\n";
+    cout << "  spin      busy-wait for this receiver, nothing is lost\n";
+    cout << "  futex     sleep until this receiver catches up, nothing is lost\n";
+    cout << "  conflate  keep going; this receiver only processes the newest pending event\n";
+    cout << "--spin-us N: spin this long on an empty ring before sleeping on a futex (default "
+         << CONSUMER_SPIN_NS / 1000 << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+    signal(SIGINT, handle_sigint);
+
+    BackpressurePolicy policy = POLICY_DROP;
+    uint64_t spin_ns = CONSUMER_SPIN_NS;
+    string name;
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if (arg == "--policy" && a + 1 < argc && parse_policy(argv[a + 1], policy)) {
+            a++;
+        } else if (arg == "--name" && a + 1 < argc) {
+            name = argv[++a];
+        } else if (arg == "--spin-us" && a + 1 < argc) {
+            spin_ns = stoull(argv[++a]) * 1000;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ControlPlane* control = attachControlPlane();
+    if (!control) {
+        cerr << "Failed to read run configuration. Exiting.\n";
+        return 1;
+    }
+
+    Date start_date = dateFromDays(control->run.start_days);
+    Date end_date = dateFromDays(control->run.end_days);
+    string holidays_file(control->run.holidays_file, strnlen(control->run.holidays_file, sizeof(control->run.holidays_file)));
+
+    // Calibrate now rather than on the first sampled tick
+    if (control->run.sample_every) latency_clock = &TscClock::instance();
+
+    // Same trading days as the generator, so both skip the same dates
+    TradingCalendar calendar;
+    string calendar_error;
+    if (!holidays_file.empty() && !calendar.load(holidays_file, calendar_error)) {
+        cerr << "Error: " << calendar_error << "\n";
+        munmap(control, sizeof(ControlPlane));
+        return 1;
+    }
+
+    cout << "=== RECEIVER STARTING ===\n";
+    cout << "Will process dates from " << start_date.toString() 
+         << " to " << end_date.toString() << "\n";
+
+    Date current_date = next_trading_date(calendar, start_date);
+    int total_days = 0;
+
+    const char* shm_name = control->run.ring_shm;
+    int fd = shm_open(shm_name, O_RDWR, 0666);
+    if (fd < 0) {
+        cerr << "Error: Unable to open shared memory. Make sure generator is running first.\n";
+        munmap(control, sizeof(ControlPlane));
+        return 1;
+    }
+
+    size_t shm_size = sizeof(SharedRingBuffer);
+    auto* ring = static_cast<SharedRingBuffer*>(
+        mmap(nullptr, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+    );
+    
+    if (ring == MAP_FAILED) {
+        cerr << "Error: Failed to map shared memory.\n";
+        close(fd);
+        munmap(control, sizeof(ControlPlane));
+        return 1;
+    }
+
+    // Our own cursor on the broadcast ring; the generator waits for its receivers to attach
+    int consumer_id = ring->register_consumer(policy);
+    if (consumer_id < 0) {
+        cerr << "Error: " << MAX_CONSUMERS << " receivers already attached to " << shm_name << ".\n";
+        munmap(ring, shm_size);
+        close(fd);
+        munmap(control, sizeof(ControlPlane));
+        return 1;
+    }
+    control->join(consumer_id, static_cast<uint32_t>(getpid()), policy);
+    if (name.empty()) name = "consumer " + to_string(consumer_id);
+
+    cout << "Broadcast Ring Buffer Receiver \"" << name << "\" connected as consumer " << consumer_id
+         << " (" << policy_name(policy) << "). Buffer size: " << RING_SIZE << " events\n";
+    cout << "Waiting for generator to start...\n";
+
+    // Sessions the generator numbers its days by; ours follow the last one acknowledged
+    uint32_t session = ring->next_day(consumer_id);
+    ring->wait_for_day(session, keep_running);
+
+    if (!keep_running) {
+        cout << "Terminated before generator started.\n";
+        control->leave(consumer_id);
+        ring->unregister_consumer(consumer_id);
+        munmap(ring, shm_size);
+        munmap(control, sizeof(ControlPlane));
+        close(fd);
+        return 0;
+    }
+
+    cout << "Generator started! Beginning event processing...\n";
+
+    // Joined mid-run: the first day to wait for is the one the generator is on
+    LiveState joined = control->live.load();
+    if (joined.session == session) current_date = dateFromDays(joined.date_days);
+
+    while (current_date <= end_date && keep_running) {
+
+        cout << "\n=== WAITING FOR DATE: " << current_date.toString() << " ===\n";
+
+        // Parked until the generator has opened this day
+        if (!ring->wait_for_day(session, keep_running)) break;
+
+        // The generator names the session's date; it is the same unless we joined mid-run
+        LiveState live = control->live.load();
+        if (live.session == session) current_date = dateFromDays(live.date_days);
+
+        uint64_t ticks = jiffies_from_1980_to_virtual_day(current_date);
+        cout << "Jiffies before today start: " << ticks << endl;
+
+        cout << "Generator started for " << current_date.toString() << "! Beginning event processing...\n";
+
+        ConsumerCounters day_start = ring->counters(consumer_id);
+        auto start_time = chrono::high_resolution_clock::now();
+        
+        // Ring buffer consumer logic; each drained span costs one tail store
+        while(keep_running) {
+            bool processed_events = false;
+            
+            // Process available events
+            processed_events = drain_ring(ring, consumer_id, policy);
+            
+            // Check if producer finished and buffer is empty
+            bool producer_finished = ring->day_done();
+            if (!processed_events && producer_finished) {
+                // Final drain - pick up anything published before the finish flag
+                processed_events = drain_ring(ring, consumer_id, policy);
+                
+                if (!processed_events) {
+                    cout << "All events processed for " << current_date.toString() << ". Day complete.\n";
+                    break;
+                }
+            }
+            
+            // Nothing to do: spin briefly, then sleep on the ring's futex until the
+            // generator publishes or finishes the day
+            if (!processed_events) {
+                parked_waits += ring->wait_for_events(consumer_id, spin_ns, keep_running);
+            }
+        }
+
+        auto end_time = chrono::high_resolution_clock::now();
+        
+        auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(end_time - start_time).count();
+        double elapsed_sec = elapsed_ms / 1000.0;
+        double sim_seconds = events_processed / static_cast<double>(JIFFIES_PER_SEC);
+        double processing_rate = elapsed_sec > 0 ? events_processed / elapsed_sec : 0.0;
+
+        // Read final statistics with relaxed ordering
+        uint64_t total_generated = ring->total_generated.load(memory_order_relaxed);
+        uint64_t dropped_count = ring->dropped_count.load(memory_order_relaxed);
+
+        cout << fixed << setprecision(6);
+        cout << "\n=== RELAXED ATOMIC RECEIVER STATS (" << name << ") ===\n";
+        cout << "Events Processed:         " << events_processed << "\n";
+        cout << "Total Generated:          " << total_generated << "\n";
+        cout << "Dropped by Producer:      " << dropped_count << "\n";
+        cout << "Simulated Time:           " << sim_seconds << " sec\n";
+        cout << "Processing Rate:          " << processing_rate << " events/sec\n";
+        cout << "Last Jiffy:               " << last_jiffy << "\n";
+        cout << "Records Received:         " << records_received << "\n";
+        cout << "Payload Bytes:            " << payload_bytes << "\n";
+
+        ConsumerCounters day_end = ring->counters(consumer_id);
+        cout << "Backpressure Policy:      " << policy_name(policy) << "\n";
+        cout << "Dropped (lapped):         " << (day_end.dropped - day_start.dropped) << "\n";
+        cout << "Conflated:                " << (day_end.conflated - day_start.conflated) << "\n";
+        cout << "Producer Stalls:          " << (day_end.stalls - day_start.stalls) << "\n";
+        cout << "Stall Time:               " << (day_end.stall_ns - day_start.stall_ns) / 1e6 << " ms\n";
+        cout << "Parked Waits:             " << parked_waits << "\n";
+        if (latency_clock) {
+            auto lat_us = [&](uint64_t ticks) { return latency_clock->to_ns(ticks) / 1000.0; };
+            cout << setprecision(3);
+            cout << "Latency Samples:          " << latency.count() << "\n";
+            cout << "Latency p50/p99/p99.9:    " << lat_us(latency.percentile(50)) << " / " << lat_us(latency.percentile(99))
+                 << " / " << lat_us(latency.percentile(99.9)) << " us\n";
+            cout << "Latency Max:              " << lat_us(latency.max()) << " us\n";
+        }
+
+        // Drained and read the day's totals: the generator may open the next day
+        if (keep_running) ring->ack_day(consumer_id, session);
+        session++;
+
+        total_days++;
+
+        // Reset event counter for next day
+        events_processed = 0;
+        records_received = 0;
+        payload_bytes = 0;
+        parked_waits = 0;
+        latency.reset();
+        
+        // Move to next trading day
+        current_date = next_trading_date(calendar, current_date.addDays(1));
+    }
+
+    control->leave(consumer_id);
+    ring->unregister_consumer(consumer_id);
+    munmap(ring, shm_size);
+    close(fd);
+    munmap(control, sizeof(ControlPlane));
+    return 0;
+}
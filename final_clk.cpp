@@ -2,6 +2,10 @@
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <string>
+
+#include "pacer.h"
+
 using namespace std;
 
 using Clock = chrono::steady_clock;
@@ -21,22 +25,30 @@ void handle_sigint(int) {
     keep_running = false;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     signal(SIGINT, handle_sigint);
 
-    volatile uint64_t factor = 0;
+    // Replay speed (1 = real time), 0 = as fast as possible
+    uint64_t factor = 0;
+    if (argc > 2 || (argc > 1 && !parse_speedup(argv[1], factor))) {
+        cerr << "Usage: " << argv[0] << " [speed]\n";
+        cerr << "  speed  replay at this many times real time, 0 = as fast as possible (default 0)\n";
+        return 1;
+    }
     volatile uint64_t ticks = 0;
+    Pacer pacer(factor, JIFFIES_PER_SEC);
     start_time = chrono::high_resolution_clock::now();
+    pacer.start();
 
     if(factor==0){
         for(;keep_running && ticks < TOTAL_JIFFIES;){
             ticks++;
         }
     }else{
+        // Each tick is due at an absolute TSC deadline for <factor>x
         for(;keep_running && ticks < TOTAL_JIFFIES;){
             ticks++;
-            volatile int i = 0;
-            while(i<factor){i++;};
+            pacer.wait(ticks);
         }
     }
     
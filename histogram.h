@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Log-linear histogram in the HDR style: values below 2^SUB_BITS get a bucket each, and every
+// power-of-two range above that is split into 2^SUB_BITS linear buckets, so a reported value
+// is within 1/2^SUB_BITS (about 3%) of what was recorded. Recording is a count-leading-zeros,
+// a shift and an increment; fixed size, no allocation.
+class LogHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = 1ULL << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    LogHistogram() { reset(); }
+
+    void reset() {
+        memset(counts_, 0, sizeof(counts_));
+        total_ = 0;
+        max_ = 0;
+    }
+
+    void record(uint64_t value) {
+        counts_[index(value)]++;
+        total_++;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LogHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; i++) counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t max() const { return max_; }
+
+    // Smallest recorded bucket value with at least `pct` percent of samples at or below it
+    uint64_t percentile(double pct) const {
+        if (!total_) return 0;
+        uint64_t rank = static_cast<uint64_t>(pct / 100.0 * total_ + 0.5);
+        rank = std::min(std::max<uint64_t>(rank, 1), total_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(highest_in(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static size_t index(uint64_t v) {
+        if (v < SUB_COUNT) return static_cast<size_t>(v);
+        unsigned msb = 63 - __builtin_clzll(v);
+        unsigned shift = msb - SUB_BITS;
+        return static_cast<size_t>((shift + 1) * SUB_COUNT + ((v >> shift) - SUB_COUNT));
+    }
+
+    static uint64_t highest_in(size_t i) {
+        uint64_t range = i / SUB_COUNT, sub = i % SUB_COUNT;
+        if (range == 0) return sub;
+        unsigned shift = static_cast<unsigned>(range - 1);
+        return ((SUB_COUNT + sub) << shift) + ((1ULL << shift) - 1);
+    }
+
+    uint64_t counts_[BUCKETS];
+    uint64_t total_;
+    uint64_t max_;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#include "udp_batch.h"
+
+// Wire framing for one jiffy's records. Every datagram starts with this header (host byte
+// order; sender and receivers share a host) followed by whole records. A receiver
+// detects a lost jiffy from a gap in sequence and a lost fragment from fragment_count.
+struct JiffyPacketHeader {
+    uint64_t jiffy;
+    uint32_t sequence;          // jiffy batches sent so far in this session
+    uint32_t fragment;          // index of this datagram within the jiffy batch
+    uint32_t fragment_count;    // datagrams carrying this jiffy batch; 32 bits, as a jiffy's
+                                // record count is, so even one record per datagram can't wrap
+    uint32_t reserved;
+};
+static_assert(sizeof(JiffyPacketHeader) == 24, "JiffyPacketHeader is part of the wire format");
+
+constexpr size_t IP_UDP_OVERHEAD = 20 + 8;
+constexpr size_t UDP_MAX_PAYLOAD = 65507;
+constexpr size_t GSO_MAX_SEGMENTS = 64;
+
+// Splits each jiffy batch on record boundaries into MTU-sized datagrams and queues them on a
+// UdpBatchSender. With UDP GSO the fragments of a batch go to the kernel as one buffer.
+class JiffyPacketizer {
+public:
+    JiffyPacketizer(UdpBatchSender& sender, int sock, size_t mtu, size_t record_size, bool try_gso)
+        : sender_(sender), record_size_(record_size) {
+        size_t room = mtu > IP_UDP_OVERHEAD + sizeof(JiffyPacketHeader) ? mtu - IP_UDP_OVERHEAD - sizeof(JiffyPacketHeader) : 0;
+        records_per_fragment_ = std::max<size_t>(1, room / record_size_);
+        fragment_size_ = sizeof(JiffyPacketHeader) + records_per_fragment_ * record_size_;
+        fragments_per_send_ = std::max<size_t>(1, std::min(GSO_MAX_SEGMENTS, UDP_MAX_PAYLOAD / fragment_size_));
+        gso_ = try_gso && gso_supported(sock);
+        arena_.resize(ARENA_SIZE);
+    }
+
+    // Frame and queue all records of one jiffy
+    void send(uint64_t jiffy, const char* records, size_t count) {
+        size_t fragments = (count + records_per_fragment_ - 1) / records_per_fragment_;
+        size_t bytes = fragments * sizeof(JiffyPacketHeader) + count * record_size_;
+
+        // Framed bytes live in the arena until the sender has flushed them
+        if (sender_.pending() == 0) used_ = 0;
+        if (used_ + bytes > arena_.size()) {
+            sender_.flush();
+            used_ = 0;
+            if (bytes > arena_.size()) arena_.resize(bytes);
+        }
+
+        char* out = &arena_[used_];
+        for (size_t f = 0; f < fragments; f++) {
+            size_t n = std::min(records_per_fragment_, count - f * records_per_fragment_);
+            JiffyPacketHeader hdr{jiffy, sequence_, static_cast<uint32_t>(f), static_cast<uint32_t>(fragments), 0};
+            memcpy(out, &hdr, sizeof(hdr));
+            memcpy(out + sizeof(hdr), records + f * records_per_fragment_ * record_size_, n * record_size_);
+            out += sizeof(hdr) + n * record_size_;
+        }
+        sequence_++;
+        datagrams_ += fragments;
+
+        // Every fragment but the last of a GSO buffer is exactly fragment_size_, as UDP_SEGMENT requires
+        const char* base = &arena_[used_];
+        used_ += bytes;
+        auto now = UdpBatchSender::Clock::now();
+        size_t step = gso_ ? fragments_per_send_ : 1;
+        for (size_t f = 0; f < fragments; f += step) {
+            size_t k = std::min(step, fragments - f);
+            const char* start = base + f * fragment_size_;
+            size_t len = (f + k == fragments) ? static_cast<size_t>(base + bytes - start) : k * fragment_size_;
+            sender_.add(start, len, now, k > 1 ? static_cast<uint16_t>(fragment_size_) : 0);
+        }
+    }
+
+    bool gso() const { return gso_; }
+    size_t records_per_fragment() const { return records_per_fragment_; }
+    uint64_t datagrams() const { return datagrams_; }
+
+    // Sequence numbers restart with every replay session
+    void start_session() {
+        sequence_ = 0;
+        datagrams_ = 0;
+    }
+
+private:
+    static constexpr size_t ARENA_SIZE = 4 << 20;
+
+    static bool gso_supported(int sock) {
+#ifdef UDP_SEGMENT
+        int probe = 1400;
+        if (setsockopt(sock, SOL_UDP, UDP_SEGMENT, &probe, sizeof(probe)) != 0) return false;
+        probe = 0;
+        setsockopt(sock, SOL_UDP, UDP_SEGMENT, &probe, sizeof(probe));
+        return true;
+#else
+        (void)sock;
+        return false;
+#endif
+    }
+
+    UdpBatchSender& sender_;
+    size_t record_size_;
+    size_t records_per_fragment_;
+    size_t fragment_size_;
+    size_t fragments_per_send_;
+    bool gso_ = false;
+    std::vector<char> arena_;
+    size_t used_ = 0;
+    uint32_t sequence_ = 0;
+    uint64_t datagrams_ = 0;
+};
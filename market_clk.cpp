@@ -2,6 +2,10 @@
 #include <chrono>
 #include <csignal>
 #include <iomanip>
+#include <string>
+#include <sys/resource.h>
+
+#include "pacer.h"
 
 using namespace std;
 using Clock = chrono::steady_clock;
@@ -37,27 +41,68 @@ void print_jiffy_time(uint64_t jiffy) {
          << setw(5) << jiff_in_sec << "\r" << flush;
 }
 
-int main() {
-    int factor = 1000; // Speed multiplier (1 = real time)
+void printUsage(const char* program_name) {
+    cout << "Usage: " << program_name << " [--speed X] [--catch-up burst|skip|fail] [--max-lag-us N]\n";
+    cout << "       [--pacing spin|hybrid] [--slack-us N]\n";
+    cout << "  --speed X         replay at X times real time (default 1000)\n";
+    cout << "  --catch-up P      once more than max lag behind: burst through the backlog, skip to the\n";
+    cout << "                    jiffy due now, or fail the session (default burst)\n";
+    cout << "  --max-lag-us N    lag that counts as behind (default 1000)\n";
+    cout << "  --pacing M        spin to every deadline, or sleep until slack before it and spin the rest\n";
+    cout << "                    (hybrid; saves a core at 1x-10x at some cost in jitter) (default spin)\n";
+    cout << "  --slack-us N      hybrid mode: how long before a deadline to wake up and spin (default 5)\n";
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t factor = 1000; // Speed multiplier (1 = real time)
+    CatchUpPolicy catch_up = CATCHUP_BURST;
+    uint64_t max_lag_us = 1000;
+    bool hybrid = false;
+    uint64_t slack_us = 5;
+
+    try {
+        for (int a = 1; a < argc; a++) {
+            string arg = argv[a];
+            if (arg == "--speed" && a + 1 < argc) {
+                factor = stoull(argv[++a]);
+                if (factor == 0) throw invalid_argument(arg);
+            } else if (arg == "--catch-up" && a + 1 < argc) {
+                if (!parse_catch_up(argv[++a], catch_up)) throw invalid_argument(arg);
+            } else if (arg == "--max-lag-us" && a + 1 < argc) {
+                max_lag_us = stoull(argv[++a]);
+            } else if (arg == "--pacing" && a + 1 < argc) {
+                string mode = argv[++a];
+                if (mode != "spin" && mode != "hybrid") throw invalid_argument(arg);
+                hybrid = mode == "hybrid";
+            } else if (arg == "--slack-us" && a + 1 < argc) {
+                slack_us = stoull(argv[++a]);
+            } else {
+                throw invalid_argument(arg);
+            }
+        }
+    } catch (...) {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-    // Duration of one jiffy at current factor
-    double jiffy_duration_ns = 1e9 / JIFFIES_PER_SEC / factor;
+    // Jiffy deadlines as an exact rational of TSC ticks, tracking lag on every tick
+    PacingEngine pacer(factor, catch_up, max_lag_us * 1000, JIFFIES_PER_SEC);
+    if (hybrid) {
+        pacer.set_hybrid(slack_us * 1000);
+    }
 
     // Register SIGINT (Ctrl+C) handler
     signal(SIGINT, handle_sigint);
 
     // Clock start
     auto sim_start = Clock::now();
+    pacer.start();
     volatile uint64_t jiffy_tick = 0;
+    uint64_t jiffy = 0;
 
-    while (keep_running && jiffy_tick < TOTAL_JIFFIES) {
-        // Target time for this tick
-        auto target_time = sim_start + chrono::nanoseconds((uint64_t)(jiffy_tick * jiffy_duration_ns));
-
-        // // Busy-wait until that time is reached
-        while (Clock::now() < target_time);
-
-        jiffy_tick++;
+    while (keep_running && jiffy_tick < TOTAL_JIFFIES && pacer.next(jiffy)) {
+        // Emitted through this jiffy; a skip may have jumped past some
+        jiffy_tick = min(jiffy + 1, TOTAL_JIFFIES);
 
         // if (jiffy_tick % JIFFIES_PER_SEC == 0) {
         //     print_jiffy_time(jiffy_tick);
@@ -66,13 +111,47 @@ int main() {
 
     // Final time
     auto sim_end = Clock::now();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                         usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
     chrono::duration<double> real_elapsed = sim_end - sim_start;
     double sim_seconds = jiffy_tick / (double)JIFFIES_PER_SEC;
 
+    const PacingEngine::Stats& st = pacer.stats();
+    auto lag_us = [&](uint64_t ticks) { return pacer.clock().to_ns(ticks) / 1000.0; };
+
     cout << "\n\n--- Final Simulation Stats ---\n";
     cout << "Simulated seconds: " << fixed << setprecision(6) << sim_seconds << " s\n";
     cout << "Wall-clock seconds: " << fixed << setprecision(6) << real_elapsed.count() << " s\n";
     cout << "Speedup factor observed: " << sim_seconds / real_elapsed.count() << "x\n";
 
+    cout << "\n--- Pacing Lag ---\n";
+    cout << "Catch-up policy: " << catch_up_name(catch_up) << " (max lag " << max_lag_us << " us)\n";
+    cout << "Ticks emitted: " << st.ticks << "\n";
+    cout << "Late ticks: " << st.late << "\n";
+    cout << "Skipped jiffies: " << st.skipped << "\n";
+    cout << setprecision(3);
+    cout << "Lag p50 / p90 / p99 / p99.9: " << lag_us(st.lag.percentile(50)) << " / " << lag_us(st.lag.percentile(90))
+         << " / " << lag_us(st.lag.percentile(99)) << " / " << lag_us(st.lag.percentile(99.9)) << " us\n";
+    cout << "Lag max: " << lag_us(st.lag.max()) << " us\n";
+
+    cout << "\n--- Pacing Jitter ---\n";
+    if (hybrid) {
+        cout << "Pacing mode: hybrid (sleep to " << slack_us << " us before deadline, then spin)\n";
+        cout << "Sleeps: " << st.sleeps << "\n";
+    } else {
+        cout << "Pacing mode: spin\n";
+    }
+    cout << "Interval jitter p50 / p90 / p99 / p99.9: " << lag_us(st.jitter.percentile(50)) << " / " << lag_us(st.jitter.percentile(90))
+         << " / " << lag_us(st.jitter.percentile(99)) << " / " << lag_us(st.jitter.percentile(99.9)) << " us\n";
+    cout << "Interval jitter max: " << lag_us(st.jitter.max()) << " us\n";
+    cout << setprecision(1);
+    cout << "CPU utilization: " << 100.0 * cpu_seconds / real_elapsed.count() << "%\n";
+    if (pacer.failed()) {
+        cout << "[FAILED] Fell more than " << max_lag_us << " us behind at jiffy " << jiffy_tick << "\n";
+        return 2;
+    }
+
     return 0;
 }
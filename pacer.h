@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <sys/prctl.h>
+
+#include "histogram.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// Replay pacing against the time-stamp counter. The TSC is calibrated once against
+// CLOCK_MONOTONIC, and each jiffy gets an absolute TSC deadline computed from the session
+// start, so the replay rate depends only on the requested speedup and not on the host,
+// compiler or turbo state. Errors don't accumulate: a late tick doesn't move later ones.
+//
+// Without an invariant TSC (or off x86) the counter falls back to CLOCK_MONOTONIC itself.
+
+class TscClock {
+public:
+    // Process-wide instance, calibrated on first use
+    static const TscClock& instance() {
+        static const TscClock clock;
+        return clock;
+    }
+
+    uint64_t now() const {
+#if defined(__x86_64__) || defined(__i386__)
+        if (invariant_) return __rdtsc();
+#endif
+        return monotonic_ns();
+    }
+
+    uint64_t ticks_per_sec() const { return hz_; }
+    bool invariant_tsc() const { return invariant_; }
+
+    // Counter ticks <-> nanoseconds
+    uint64_t to_ns(uint64_t ticks) const {
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(ticks) * 1000000000ULL / hz_);
+    }
+    uint64_t from_ns(uint64_t ns) const {
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(ns) * hz_ / 1000000000ULL);
+    }
+
+    static uint64_t monotonic_ns() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+
+private:
+    static constexpr uint64_t CALIBRATION_NS = 50000000;       // 50 ms
+
+    TscClock() : invariant_(has_invariant_tsc()), hz_(1000000000ULL) {
+        if (invariant_) hz_ = calibrate();
+    }
+
+    static bool has_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return (edx >> 8) & 1;
+#endif
+        return false;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Monotonic time bracketed by two TSC reads; the TSC value is taken at the midpoint,
+    // retrying when a preemption or interrupt widens the bracket
+    static void sample(uint64_t& tsc, uint64_t& ns) {
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < 16; i++) {
+            uint64_t t0 = __rdtsc();
+            uint64_t n = monotonic_ns();
+            uint64_t t1 = __rdtsc();
+            if (t1 - t0 < best) {
+                best = t1 - t0;
+                tsc = t0 + (t1 - t0) / 2;
+                ns = n;
+            }
+        }
+    }
+
+    static uint64_t calibrate() {
+        uint64_t tsc0 = 0, ns0 = 0, tsc1 = 0, ns1 = 0;
+        sample(tsc0, ns0);
+        struct timespec pause = {0, static_cast<long>(CALIBRATION_NS)};
+        nanosleep(&pause, nullptr);
+        sample(tsc1, ns1);
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(tsc1 - tsc0) * 1000000000ULL / (ns1 - ns0));
+    }
+#else
+    static uint64_t calibrate() { return 1000000000ULL; }
+#endif
+
+    bool invariant_;
+    uint64_t hz_;
+};
+
+// A speedup as given on the command line: decimal digits only, so "-1" is refused instead of
+// wrapping to a huge speed, and so is anything past what fits in 64 bits
+inline bool parse_speedup(const char* text, uint64_t& speedup) {
+    if (*text < '0' || *text > '9') return false;
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long value = strtoull(text, &end, 10);
+    if (errno == ERANGE || *end != '\0') return false;
+    speedup = value;
+    return true;
+}
+
+// Deadline pacer for a stream of jiffies at <speedup>x real time; speedup 0 means unpaced.
+// Call start() at the first jiffy, then wait(n) before emitting the jiffy n past it.
+class Pacer {
+public:
+    explicit Pacer(uint64_t speedup, uint64_t jiffies_per_sec = 1 << 16)
+        : clock_(TscClock::instance()), speedup_(speedup), start_(0), ticks_per_jiffy_(0) {
+        if (speedup_) {
+            // Counter ticks per jiffy in 32.32 fixed point
+            ticks_per_jiffy_ = static_cast<uint64_t>(
+                (static_cast<unsigned __int128>(clock_.ticks_per_sec()) << 32) / (jiffies_per_sec * speedup_));
+        }
+    }
+
+    void start() { start_ = clock_.now(); }
+
+    bool paced() const { return speedup_ != 0; }
+    uint64_t speedup() const { return speedup_; }
+    const TscClock& clock() const { return clock_; }
+
+    // Counter value at which jiffy n (counted from start()) is due
+    uint64_t deadline(uint64_t jiffies) const {
+        return start_ + static_cast<uint64_t>((static_cast<unsigned __int128>(jiffies) * ticks_per_jiffy_) >> 32);
+    }
+
+    // Nanoseconds until jiffy n is due, 0 once it is
+    uint64_t ns_until(uint64_t jiffies) const {
+        uint64_t due = deadline(jiffies), now = clock_.now();
+        return due > now ? clock_.to_ns(due - now) : 0;
+    }
+
+    // Spin until jiffy n is due
+    void wait(uint64_t jiffies) const {
+        if (!speedup_) return;
+        uint64_t due = deadline(jiffies);
+        while (clock_.now() < due) {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        }
+    }
+
+private:
+    const TscClock& clock_;
+    uint64_t speedup_;
+    uint64_t start_;
+    uint64_t ticks_per_jiffy_;
+};
+
+// What PacingEngine does once the stream is more than max_lag behind its deadlines
+enum CatchUpPolicy {
+    CATCHUP_BURST,      // emit back to back, without waiting, until caught up
+    CATCHUP_SKIP,       // jump straight to the jiffy due now
+    CATCHUP_FAIL        // stop the session
+};
+
+inline const char* catch_up_name(CatchUpPolicy policy) {
+    switch (policy) {
+        case CATCHUP_BURST: return "burst";
+        case CATCHUP_SKIP: return "skip";
+        case CATCHUP_FAIL: return "fail";
+    }
+    return "unknown";
+}
+
+inline bool parse_catch_up(const std::string& name, CatchUpPolicy& policy) {
+    for (CatchUpPolicy p : {CATCHUP_BURST, CATCHUP_SKIP, CATCHUP_FAIL}) {
+        if (name == catch_up_name(p)) {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Dense jiffy pacing with lag telemetry. The counter ticks per jiffy are kept as an exact
+// rational (ticks_per_sec / (jiffies_per_sec * speedup)) and the deadline is stepped by its
+// quotient and remainder, so a whole day of jiffies accumulates no rounding drift and a
+// tick costs no division. Every tick's lag behind its deadline goes into a histogram.
+//
+// By default the engine spins to each deadline. In hybrid mode (set_hybrid) it first sleeps
+// with clock_nanosleep(TIMER_ABSTIME) until `slack` before the deadline and spins only the
+// rest, trading precision for an idle core at low speedups; the interval jitter histogram
+// shows what that costs.
+class PacingEngine {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t late = 0;          // ticks emitted more than max_lag behind
+        uint64_t skipped = 0;       // jiffies jumped over by CATCHUP_SKIP
+        uint64_t sleeps = 0;        // hybrid mode clock_nanosleep() calls
+        LogHistogram lag;           // counter ticks behind deadline, per emitted jiffy
+        LogHistogram jitter;        // |interval since previous tick - nominal|, counter ticks
+    };
+
+    PacingEngine(uint64_t speedup, CatchUpPolicy policy, uint64_t max_lag_ns, uint64_t jiffies_per_sec = 1 << 16)
+        : clock_(TscClock::instance()), speedup_(speedup), policy_(policy),
+          max_lag_(clock_.from_ns(max_lag_ns)), den_(jiffies_per_sec * (speedup ? speedup : 1)),
+          step_(clock_.ticks_per_sec() / den_), rem_step_(clock_.ticks_per_sec() % den_) {}
+
+    // Sleep until `slack_ns` before each deadline, then spin. Asks the kernel for a 1 ns timer
+    // slack so wakeups are not rounded up by the default 50 us.
+    void set_hybrid(uint64_t slack_ns) {
+        sleep_slack_ = clock_.from_ns(slack_ns);
+        hybrid_ = true;
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+    }
+
+    bool hybrid() const { return hybrid_; }
+
+    void start() {
+        deadline_ = clock_.now();
+        last_emit_ = 0;
+        rem_ = 0;
+        next_ = 0;
+        failed_ = false;
+        stats_ = Stats();
+    }
+
+    // Wait for the next jiffy to be due and return it (counted from start()). False once the
+    // session has failed under CATCHUP_FAIL. Unpaced engines return every jiffy at once.
+    bool next(uint64_t& jiffy) {
+        if (failed_) return false;
+        if (!speedup_) {
+            jiffy = next_++;
+            stats_.ticks++;
+            return true;
+        }
+
+        uint64_t now = clock_.now();
+        if (hybrid_ && now < deadline_ && deadline_ - now > sleep_slack_) {
+            sleep_until(deadline_ - sleep_slack_, now);
+            now = clock_.now();
+        }
+        while (now < deadline_) {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+            now = clock_.now();
+        }
+
+        uint64_t lag = now - deadline_;
+        if (lag > max_lag_) {
+            stats_.late++;
+            if (policy_ == CATCHUP_FAIL) {
+                stats_.lag.record(lag);
+                failed_ = true;
+                return false;
+            }
+            if (policy_ == CATCHUP_SKIP) {
+                // Jiffies whose deadlines have all passed
+                uint64_t behind = static_cast<uint64_t>(static_cast<unsigned __int128>(lag) * den_ / clock_.ticks_per_sec());
+                advance(behind);
+                next_ += behind;
+                stats_.skipped += behind;
+                lag = now - deadline_;
+            }
+        }
+
+        stats_.lag.record(lag);
+        if (last_emit_) {
+            uint64_t interval = now - last_emit_;
+            stats_.jitter.record(interval > step_ ? interval - step_ : step_ - interval);
+        }
+        last_emit_ = now;
+        stats_.ticks++;
+        jiffy = next_++;
+        deadline_ += step_;
+        rem_ += rem_step_;
+        if (rem_ >= den_) {
+            rem_ -= den_;
+            deadline_++;
+        }
+        return true;
+    }
+
+    // Counter ticks the stream is behind right now, 0 when ahead
+    uint64_t current_lag() const {
+        uint64_t now = clock_.now();
+        return now > deadline_ ? now - deadline_ : 0;
+    }
+
+    bool failed() const { return failed_; }
+    bool paced() const { return speedup_ != 0; }
+    CatchUpPolicy policy() const { return policy_; }
+    const Stats& stats() const { return stats_; }
+    const TscClock& clock() const { return clock_; }
+
+private:
+    // Absolute CLOCK_MONOTONIC sleep to counter value `target`, `now` being the counter value now
+    void sleep_until(uint64_t target, uint64_t now) {
+        uint64_t wake_ns = TscClock::monotonic_ns() + clock_.to_ns(target - now);
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(wake_ns / 1000000000ULL);
+        ts.tv_nsec = static_cast<long>(wake_ns % 1000000000ULL);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        stats_.sleeps++;
+    }
+
+    // Step the deadline by many jiffies at once (skips); the per-tick step is inlined in next()
+    void advance(uint64_t jiffies) {
+        unsigned __int128 rem = static_cast<unsigned __int128>(rem_step_) * jiffies + rem_;
+        deadline_ += step_ * jiffies + static_cast<uint64_t>(rem / den_);
+        rem_ = static_cast<uint64_t>(rem % den_);
+    }
+
+    const TscClock& clock_;
+    uint64_t speedup_;
+    CatchUpPolicy policy_;
+    uint64_t max_lag_;
+    uint64_t den_;
+    uint64_t step_;
+    uint64_t rem_step_;
+
+    uint64_t deadline_ = 0;
+    uint64_t rem_ = 0;
+    uint64_t next_ = 0;
+    uint64_t last_emit_ = 0;
+    bool hybrid_ = false;
+    uint64_t sleep_slack_ = 0;
+    bool failed_ = false;
+    Stats stats_;
+};
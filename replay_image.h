@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary replay image layout (all fields little-endian, native packing):
+//
+//   [ReplayImageHeader][record bodies, packed by jiffy][JiffyIndexEntry x jiffy_count]
+//   [10-byte symbol names x symbol_count]
+//
+// The body holds the records of the sorted .DAT file back to back, so the records of
+// one jiffy are contiguous. The index has one entry per populated jiffy, sorted by jiffy.
+// Records are either the raw 88-byte ASCII records or BinaryRecords (binary_record.h),
+// whose symbol ids index the symbol table.
+
+constexpr uint64_t REPLAY_IMAGE_MAGIC = 0x31474D4959504C52ULL;   // "RPLYIMG1"
+constexpr uint32_t REPLAY_IMAGE_VERSION = 2;
+constexpr size_t DAT_RECORD_SIZE = 88;
+constexpr size_t BINARY_RECORD_SIZE = 72;      // sizeof(BinaryRecord)
+constexpr size_t DAT_JIFFY_OFFSET = 22;
+constexpr size_t DAT_JIFFY_DIGITS = 14;
+constexpr size_t DAT_SYMBOL_OFFSET = 38;
+constexpr size_t DAT_SYMBOL_SIZE = 10;
+
+enum RecordFormat : uint32_t {
+    RECORD_FORMAT_DAT = 0,          // 88-byte ASCII .DAT records
+    RECORD_FORMAT_BINARY = 1,       // BinaryRecord
+};
+
+struct ReplayImageHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t jiffy_count;
+    uint64_t record_count;
+    uint64_t body_offset;
+    uint64_t index_offset;
+    uint32_t record_format;
+    uint32_t symbol_count;
+    uint64_t symbol_offset;
+};
+
+struct JiffyIndexEntry {
+    uint64_t jiffy;
+    uint64_t first_record;
+    uint32_t record_count;
+    uint32_t reserved;
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Eight ASCII digits, first digit in the low byte, as a number; false if any byte isn't a digit.
+// Digit pairs, then quads, then the two halves are combined with three multiplies (SWAR).
+inline bool parse_8_digits(const char* p, uint64_t& value) {
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    // Every byte in '0'..'9': high nibble 3, and adding 6 doesn't carry out of the low nibble
+    if (((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL) {
+        return false;
+    }
+    x -= 0x3030303030303030ULL;
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+    value = (x * 10000 + (x >> 32)) & 0xFFFFFFFFULL;
+    return true;
+}
+#endif
+
+// Parse the 14-digit ASCII jiffy field of a .DAT record without allocating. On little-endian
+// hosts this is two overlapping 8-digit SWAR loads (digits 0-7 and 6-13) instead of a
+// 14-step multiply-add chain.
+inline bool parse_record_jiffy(const char* rec, uint64_t& jiffy) {
+    static_assert(DAT_JIFFY_DIGITS == 14, "parse_record_jiffy expects a 14-digit field");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t high, low;
+    if (!parse_8_digits(rec + DAT_JIFFY_OFFSET, high) || !parse_8_digits(rec + DAT_JIFFY_OFFSET + 6, low)) {
+        return false;
+    }
+    jiffy = high * 1000000 + low % 1000000;
+    return true;
+#else
+    uint64_t value = 0;
+    for (size_t i = 0; i < DAT_JIFFY_DIGITS; i++) {
+        unsigned d = static_cast<unsigned char>(rec[DAT_JIFFY_OFFSET + i]) - '0';
+        if (d > 9) return false;
+        value = value * 10 + d;
+    }
+    jiffy = value;
+    return true;
+#endif
+}
+
+// Read-only view over an index and its record bodies, whether mapped or in memory
+struct ReplayView {
+    const JiffyIndexEntry* index = nullptr;
+    size_t jiffy_count = 0;
+    const char* body = nullptr;
+    size_t record_count = 0;
+    size_t record_size = DAT_RECORD_SIZE;
+    uint32_t record_format = RECORD_FORMAT_DAT;
+    const char* symbols = nullptr;          // symbol_count DAT_SYMBOL_SIZE names, binary format only
+    size_t symbol_count = 0;
+
+    const JiffyIndexEntry* begin() const { return index; }
+    const JiffyIndexEntry* end() const { return index + jiffy_count; }
+
+    // First populated jiffy >= jiffy
+    const JiffyIndexEntry* lower_bound(uint64_t jiffy) const {
+        return std::lower_bound(begin(), end(), jiffy,
+            [](const JiffyIndexEntry& e, uint64_t j) { return e.jiffy < j; });
+    }
+
+    const char* records(const JiffyIndexEntry& e) const {
+        return body + e.first_record * record_size;
+    }
+
+    size_t bytes(const JiffyIndexEntry& e) const {
+        return static_cast<size_t>(e.record_count) * record_size;
+    }
+};
+
+// Replay image mapped read-only; pages are shared through the page cache across processes
+class ReplayImage {
+public:
+    ReplayImage() = default;
+    ReplayImage(const ReplayImage&) = delete;
+    ReplayImage& operator=(const ReplayImage&) = delete;
+    ~ReplayImage() { close(); }
+
+    bool open(const std::string& path, std::string& error) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "unable to open " + path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ReplayImageHeader)) {
+            error = path + " is too small to be a replay image";
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* base = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            error = "mmap of " + path + " failed: " + strerror(errno);
+            size_ = 0;
+            return false;
+        }
+        base_ = static_cast<const char*>(base);
+
+        const auto* hdr = reinterpret_cast<const ReplayImageHeader*>(base_);
+        if (hdr->magic != REPLAY_IMAGE_MAGIC || hdr->version != REPLAY_IMAGE_VERSION) {
+            error = path + " is not a version " + std::to_string(REPLAY_IMAGE_VERSION) + " replay image";
+            close();
+            return false;
+        }
+        size_t expected_size = hdr->record_format == RECORD_FORMAT_DAT ? DAT_RECORD_SIZE
+                             : hdr->record_format == RECORD_FORMAT_BINARY ? BINARY_RECORD_SIZE : 0;
+        if (!expected_size || hdr->record_size != expected_size) {
+            error = path + " is corrupt: record format " + std::to_string(hdr->record_format) +
+                    " with " + std::to_string(hdr->record_size) + "-byte records";
+            close();
+            return false;
+        }
+        // Divide rather than multiply, so huge counts can't wrap past the check
+        auto fits = [&](uint64_t offset, uint64_t count, size_t item) {
+            return offset <= size_ && count <= (size_ - offset) / item;
+        };
+        if (!fits(hdr->body_offset, hdr->record_count, hdr->record_size) ||
+            !fits(hdr->index_offset, hdr->jiffy_count, sizeof(JiffyIndexEntry)) ||
+            !fits(hdr->symbol_offset, hdr->symbol_count, DAT_SYMBOL_SIZE)) {
+            error = path + " is truncated";
+            close();
+            return false;
+        }
+        if (hdr->index_offset % alignof(JiffyIndexEntry)) {
+            error = path + " is corrupt: misaligned jiffy index";
+            close();
+            return false;
+        }
+
+        // Replay reads the body straight through the index, so every entry must stay inside it
+        const auto* index = reinterpret_cast<const JiffyIndexEntry*>(base_ + hdr->index_offset);
+        for (uint64_t i = 0; i < hdr->jiffy_count; i++) {
+            const JiffyIndexEntry& e = index[i];
+            if (e.first_record > hdr->record_count || e.record_count > hdr->record_count - e.first_record ||
+                (i && e.jiffy <= index[i - 1].jiffy)) {
+                error = path + " is corrupt: jiffy index entry " + std::to_string(i) + " (jiffy " +
+                        std::to_string(e.jiffy) + ", records " + std::to_string(e.first_record) + "+" +
+                        std::to_string(e.record_count) + " of " + std::to_string(hdr->record_count) + ")";
+                close();
+                return false;
+            }
+        }
+
+        view_.index = index;
+        view_.jiffy_count = hdr->jiffy_count;
+        view_.body = base_ + hdr->body_offset;
+        view_.record_count = hdr->record_count;
+        view_.record_size = hdr->record_size;
+        view_.record_format = hdr->record_format;
+        view_.symbols = base_ + hdr->symbol_offset;
+        view_.symbol_count = hdr->symbol_count;
+
+        // Replay walks the body front to back
+        madvise(const_cast<char*>(base_), size_, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void close() {
+        if (base_) munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+        view_ = ReplayView{};
+    }
+
+    const ReplayView& view() const { return view_; }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    ReplayView view_;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#include "replay_image.h"
+
+// Sidecar index for a sorted .DAT file, kept next to it as "<file>.idx". It maps every populated
+// one-second bucket of jiffies to the byte offset of the bucket's first record, so a replay of a
+// short range reads only the records it needs instead of the whole file:
+//
+//   [SparseIndexHeader][SparseIndexEntry x entry_count, sorted by bucket]
+//
+// The header records the size and mtime of the .DAT file it was built from; an index whose file
+// has changed since is stale and gets rebuilt.
+
+constexpr uint64_t SPARSE_INDEX_MAGIC = 0x31584449534A4952ULL;   // "RIJSIDX1"
+constexpr uint32_t SPARSE_INDEX_VERSION = 1;
+constexpr uint64_t SPARSE_INDEX_BUCKET_JIFFIES = 1 << 16;        // one second
+
+struct SparseIndexHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t file_size;
+    uint64_t file_mtime_ns;
+    uint64_t bucket_jiffies;
+    uint64_t entry_count;
+};
+
+struct SparseIndexEntry {
+    uint64_t bucket;            // jiffy / bucket_jiffies
+    uint64_t offset;            // byte offset of the bucket's first record
+};
+
+class SparseIndex {
+public:
+    static std::string sidecar_path(const std::string& dat_path) { return dat_path + ".idx"; }
+
+    // Load the sidecar of dat_path; false when it is missing, malformed or stale
+    bool load(const std::string& dat_path, std::string& error) {
+        entries_.clear();
+        uint64_t size = 0, mtime_ns = 0;
+        if (!stat_file(dat_path, size, mtime_ns, error)) return false;
+
+        std::string path = sidecar_path(dat_path);
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            error = "no index at " + path;
+            return false;
+        }
+        SparseIndexHeader hdr{};
+        in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+        if (!in || hdr.magic != SPARSE_INDEX_MAGIC || hdr.version != SPARSE_INDEX_VERSION ||
+            hdr.bucket_jiffies != SPARSE_INDEX_BUCKET_JIFFIES) {
+            error = path + " is not a version " + std::to_string(SPARSE_INDEX_VERSION) + " sparse index";
+            return false;
+        }
+        if (hdr.file_size != size || hdr.file_mtime_ns != mtime_ns) {
+            error = path + " is stale (" + dat_path + " changed since it was built)";
+            return false;
+        }
+        entries_.resize(hdr.entry_count);
+        in.read(reinterpret_cast<char*>(entries_.data()), entries_.size() * sizeof(SparseIndexEntry));
+        if (!in) {
+            error = path + " is truncated";
+            entries_.clear();
+            return false;
+        }
+        file_size_ = size;
+        return true;
+    }
+
+    // Scan dat_path once and write its sidecar. The file must be sorted by jiffy. Not being able
+    // to write the sidecar isn't fatal: the index is still usable for this run.
+    bool build(const std::string& dat_path, std::string& error, bool& saved) {
+        entries_.clear();
+        saved = false;
+        uint64_t size = 0, mtime_ns = 0;
+        if (!stat_file(dat_path, size, mtime_ns, error)) return false;
+
+        std::ifstream in(dat_path, std::ios::binary);
+        if (!in) {
+            error = "unable to open " + dat_path;
+            return false;
+        }
+        std::vector<char> block(DAT_RECORD_SIZE * 4096);
+        uint64_t offset = 0, last_jiffy = 0;
+        while (in) {
+            in.read(block.data(), block.size());
+            size_t got = static_cast<size_t>(in.gcount()) / DAT_RECORD_SIZE;
+            for (size_t r = 0; r < got; r++, offset += DAT_RECORD_SIZE) {
+                uint64_t jiffy;
+                if (!parse_record_jiffy(block.data() + r * DAT_RECORD_SIZE, jiffy)) continue;
+                if (jiffy < last_jiffy) {
+                    error = dat_path + " is not sorted by jiffy (byte " + std::to_string(offset) + ")";
+                    entries_.clear();
+                    return false;
+                }
+                last_jiffy = jiffy;
+                uint64_t bucket = jiffy / SPARSE_INDEX_BUCKET_JIFFIES;
+                if (entries_.empty() || entries_.back().bucket != bucket) {
+                    entries_.push_back(SparseIndexEntry{bucket, offset});
+                }
+            }
+        }
+        file_size_ = size;
+
+        SparseIndexHeader hdr{};
+        hdr.magic = SPARSE_INDEX_MAGIC;
+        hdr.version = SPARSE_INDEX_VERSION;
+        hdr.file_size = size;
+        hdr.file_mtime_ns = mtime_ns;
+        hdr.bucket_jiffies = SPARSE_INDEX_BUCKET_JIFFIES;
+        hdr.entry_count = entries_.size();
+
+        std::ofstream out(sidecar_path(dat_path), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(SparseIndexEntry));
+        out.close();
+        saved = static_cast<bool>(out);
+        if (!saved) std::remove(sidecar_path(dat_path).c_str());
+        return true;
+    }
+
+    // Byte range of the file holding every record with a jiffy in [first_jiffy, last_jiffy], give
+    // or take the rest of the one-second buckets at either end
+    void range(uint64_t first_jiffy, uint64_t last_jiffy, uint64_t& begin, uint64_t& end) const {
+        auto after = [](const SparseIndexEntry& e, uint64_t bucket) { return e.bucket < bucket; };
+        auto lo = std::lower_bound(entries_.begin(), entries_.end(), first_jiffy / SPARSE_INDEX_BUCKET_JIFFIES, after);
+        auto hi = std::lower_bound(lo, entries_.end(), last_jiffy / SPARSE_INDEX_BUCKET_JIFFIES + 1, after);
+        begin = lo == entries_.end() ? file_size_ : lo->offset;
+        end = hi == entries_.end() ? file_size_ : hi->offset;
+    }
+
+    size_t buckets() const { return entries_.size(); }
+    uint64_t file_size() const { return file_size_; }
+
+private:
+    static bool stat_file(const std::string& path, uint64_t& size, uint64_t& mtime_ns, std::string& error) {
+        struct stat st;
+        if (stat(path.c_str(), &st) < 0) {
+            error = "unable to stat " + path + ": " + strerror(errno);
+            return false;
+        }
+        size = static_cast<uint64_t>(st.st_size);
+        mtime_ns = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + st.st_mtim.tv_nsec;
+        return true;
+    }
+
+    std::vector<SparseIndexEntry> entries_;
+    uint64_t file_size_ = 0;
+};
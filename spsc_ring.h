@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer single-consumer ring, laid out to live in shared memory (no pointers,
+// zero-filled memory is a valid empty ring).
+//
+//  - head and tail sit on their own cache lines, each next to the owner's cached copy of
+//    the opposite index, so the other side's line is only read when the cache runs out
+//  - indices grow monotonically and are masked, so Capacity must be a power of two
+//  - claim()/commit() and read()/release() move contiguous spans, so a batch costs one
+//    index store per side
+template <typename T, size_t Capacity>
+struct SpscRing {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of 2");
+    static constexpr size_t MASK = Capacity - 1;
+
+    // Contiguous run of slots; never crosses the end of the ring
+    struct Span {
+        T* data;
+        size_t count;
+    };
+
+    // Producer-owned line
+    alignas(64) std::atomic<uint64_t> head;
+    uint64_t cached_tail;
+
+    // Consumer-owned line
+    alignas(64) std::atomic<uint64_t> tail;
+    uint64_t cached_head;
+
+    alignas(64) T slots[Capacity];
+
+    // Only safe while neither side is running
+    void reset() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+        cached_tail = 0;
+        cached_head = 0;
+    }
+
+    // Producer: up to `want` free slots to fill; count is 0 when the ring is full
+    Span claim(size_t want = 1) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (Capacity - (h - cached_tail) < want) {
+            cached_tail = tail.load(std::memory_order_acquire);
+        }
+        size_t free = Capacity - (h - cached_tail);
+        size_t n = std::min(std::min(want, free), Capacity - (h & MASK));
+        return Span{&slots[h & MASK], n};
+    }
+
+    // Producer: publish the first n claimed slots
+    void commit(size_t n = 1) {
+        head.store(head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    bool try_push(const T& value) {
+        Span s = claim(1);
+        if (!s.count) return false;
+        s.data[0] = value;
+        commit(1);
+        return true;
+    }
+
+    // Consumer: up to `max` published slots to read; count is 0 when the ring is empty
+    Span read(size_t max = Capacity) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        if (cached_head == t) {
+            cached_head = head.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(std::min(max, static_cast<size_t>(cached_head - t)), Capacity - (t & MASK));
+        return Span{&slots[t & MASK], n};
+    }
+
+    // Consumer: hand the first n read slots back to the producer
+    void release(size_t n) {
+        tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    // Approximate; exact only on the owning side
+    size_t size() const {
+        return static_cast<size_t>(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+    }
+
+    bool empty() const { return size() == 0; }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "replay_image.h"
+
+// Set of 10-byte padded symbol fields, matched without allocating. Each symbol is packed into
+// an 8-byte and a 2-byte integer key and looked up in an open-addressed table kept at most
+// a quarter full, so a lookup is one hash and, almost always, one slot compare.
+class SymbolFilter {
+public:
+    // Symbols shorter than the field are right-padded with spaces, as in the .DAT file
+    bool add(const std::string& symbol) {
+        if (symbol.empty() || symbol.size() > DAT_SYMBOL_SIZE) return false;
+        char field[DAT_SYMBOL_SIZE];
+        memset(field, ' ', sizeof(field));
+        memcpy(field, symbol.data(), symbol.size());
+        if (matches(field)) return true;
+
+        keys_.push_back(key_of(field));
+        if (keys_.size() * 4 > slots_.size()) {
+            rebuild();
+        } else {
+            insert(keys_.back());
+        }
+        return true;
+    }
+
+    // Comma-separated list, as given on the command line
+    bool add_list(const std::string& list, std::string& error) {
+        std::istringstream iss(list);
+        std::string symbol;
+        while (getline(iss, symbol, ',')) {
+            if (!add(symbol)) {
+                error = "invalid symbol '" + symbol + "'";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One symbol per line; blank lines and lines starting with '#' are ignored
+    bool load_file(const std::string& path, std::string& error) {
+        std::ifstream in(path);
+        if (!in) {
+            error = "unable to open " + path;
+            return false;
+        }
+        std::string line;
+        while (getline(in, line)) {
+            size_t end = line.find_last_not_of(" \t\r");
+            if (end == std::string::npos || line[0] == '#') continue;
+            if (!add(line.substr(0, end + 1))) {
+                error = "invalid symbol '" + line + "' in " + path;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool matches(const char* field) const {
+        if (slots_.empty()) return false;
+        Key k = key_of(field);
+        for (size_t i = hash(k) & mask_;; i = (i + 1) & mask_) {
+            const Slot& s = slots_[i];
+            if (!s.used) return false;
+            if (s.key.lo == k.lo && s.key.hi == k.hi) return true;
+        }
+    }
+
+    bool empty() const { return keys_.empty(); }
+    size_t size() const { return keys_.size(); }
+
+private:
+    struct Key {
+        uint64_t lo;
+        uint16_t hi;
+    };
+
+    struct Slot {
+        Key key;
+        bool used;
+    };
+
+    static Key key_of(const char* field) {
+        Key k;
+        memcpy(&k.lo, field, sizeof(k.lo));
+        memcpy(&k.hi, field + sizeof(k.lo), sizeof(k.hi));
+        return k;
+    }
+
+    static uint64_t hash(const Key& k) {
+        uint64_t h = (k.lo ^ (uint64_t(k.hi) * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+        return h ^ (h >> 29);
+    }
+
+    void insert(const Key& k) {
+        size_t i = hash(k) & mask_;
+        while (slots_[i].used) i = (i + 1) & mask_;
+        slots_[i] = Slot{k, true};
+    }
+
+    // Grow to the next power of two that keeps the table a quarter full; capacity doubles,
+    // so loading N symbols rehashes O(N) keys in all
+    void rebuild() {
+        size_t capacity = 16;
+        while (capacity < keys_.size() * 4) capacity <<= 1;
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+        for (const Key& k : keys_) insert(k);
+    }
+
+    std::vector<Key> keys_;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+};
@@ -7,6 +7,9 @@
 #include <unistd.h>
 #include <cstring>
 #include <sys/eventfd.h>
+#include <string>
+
+#include "pacer.h"
 
 using namespace std;
 using Clock = chrono::steady_clock;
@@ -23,9 +26,16 @@ void handle_sigint(int) {
     keep_running = false;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     signal(SIGINT, handle_sigint);
 
+    uint64_t factor = 100;   // replay speed (1 = real time), 0 = unpaced
+    if (argc > 2 || (argc > 1 && !parse_speedup(argv[1], factor))) {
+        cerr << "Usage: " << argv[0] << " [speed]\n";
+        cerr << "  speed  replay at this many times real time, 0 = unpaced (default 100)\n";
+        return 1;
+    }
+
     // Shared memory setup
     const char* shm_name = "/tick_shm";
     int fd = shm_open(shm_name, O_CREAT | O_RDWR, 0666);
@@ -33,7 +43,6 @@ int main() {
     auto* tick_ptr = (volatile uint64_t*) mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
     *tick_ptr = 0;
     cout << "Writer to start ticking...\n";
-    volatile uint64_t factor = 100;
     volatile uint64_t& ticks = *tick_ptr;
 
     // sleep(10);
@@ -48,16 +57,16 @@ int main() {
         return 1;
     }
 
+    // Each tick is due at an absolute TSC deadline for <factor>x
+    Pacer pacer(factor, JIFFIES_PER_SEC);
     auto start_time = chrono::high_resolution_clock::now();
+    pacer.start();
 
     for (;keep_running && ticks < TOTAL_JIFFIES;) {
         uint64_t one = 1;
         write(efd, &one, sizeof(one));  // sends one tick
         ticks++;
-        if (factor > 0) {
-            volatile int i = 0;
-            while (i < factor) { i++; }
-        }
+        pacer.wait(ticks);
     }
 
     auto end_time = chrono::high_resolution_clock::now();
@@ -0,0 +1,544 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+#include "broadcast_ring.h"
+#include "futex.h"
+
+// Shared-memory tick ring between the clk_s generator and the emitters. Each event names
+// a jiffy and, when the generator replays records, a span of them copied in place into
+// the ring's slab. The generator writes every event once; each emitter registers its own
+// cursor and reads the events and records straight out of shared memory.
+//
+// Each emitter picks what happens when it falls a full ring (or slab) behind:
+//  - drop      the generator carries on and laps it; the emitter skips what was overwritten
+//  - spin      the generator busy-waits until it catches up
+//  - futex     the generator sleeps until it releases events
+//  - conflate  like drop, but the emitter always jumps to the newest pending event
+// Only spin and futex emitters hold the generator back, so a slow lossy emitter never
+// costs the others a tick.
+//
+// Days run as numbered sessions, from 1. The generator publishes day_started = N, the
+// day's events, then day_finished = N. Each emitter drains up to the finish and
+// acknowledges N in its slot; the generator opens day N+1 once every attached emitter has,
+// so the next day starts as soon as the last emitter is done. Ring and slab positions carry
+// on across days rather than rewinding, so an emitter may register at any point of the run.
+
+constexpr size_t RING_SIZE = 1 << 18;                    // 4 s of jiffies, must be power of 2
+constexpr size_t SLAB_SIZE = 1 << 24;                    // must be power of 2
+constexpr size_t SLAB_MASK = SLAB_SIZE - 1;
+constexpr size_t MAX_CONSUMERS = 8;
+constexpr const char* TICK_RING_SHM = "/tick_ring";
+constexpr uint64_t PRODUCER_PARK_NS = 1000000;           // futex wait bound, covers a missed wake
+constexpr uint64_t CONSUMER_PARK_NS = 10000000;          // same for parked emitters
+constexpr uint64_t CONSUMER_SPIN_NS = 50000;             // default spin before an emitter parks
+
+enum BackpressurePolicy : uint32_t {
+    POLICY_DROP = 0,
+    POLICY_SPIN = 1,
+    POLICY_FUTEX = 2,
+    POLICY_CONFLATE = 3
+};
+
+inline const char* policy_name(uint32_t policy) {
+    switch (policy) {
+        case POLICY_DROP: return "drop";
+        case POLICY_SPIN: return "spin";
+        case POLICY_FUTEX: return "futex";
+        case POLICY_CONFLATE: return "conflate";
+    }
+    return "unknown";
+}
+
+inline bool parse_policy(const std::string& name, BackpressurePolicy& policy) {
+    for (uint32_t p = POLICY_DROP; p <= POLICY_CONFLATE; p++) {
+        if (name == policy_name(p)) {
+            policy = static_cast<BackpressurePolicy>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Lossless policies: the generator waits for these consumers
+inline bool policy_blocks(uint32_t policy) {
+    return policy == POLICY_SPIN || policy == POLICY_FUTEX;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+struct TickEvent {
+    uint64_t tick_number;          // absolute jiffy since 1980-01-01
+    uint64_t timestamp_tsc;        // TscClock::now() counter ticks on sampled ticks (clk_s --sample-latency), else 0
+    uint64_t payload_offset;       // slab position of the records (monotonic, wraps by SLAB_MASK); a bare
+                                   // tick carries the slab head, so releasing it releases the slab up to there
+    uint32_t payload_size;         // bytes of records, 0 for a bare tick
+    uint32_t record_count;
+};
+
+// Records of one event, read in place from the slab
+struct RecordSpan {
+    const char* data;
+    size_t size;
+    size_t count;
+
+    bool empty() const { return size == 0; }
+    size_t record_size() const { return count ? size / count : 0; }
+    const char* record(size_t i) const { return data + i * record_size(); }
+};
+
+// Events and records a lossy consumer copied out of the ring, in its own memory
+struct EventCopy {
+    std::vector<TickEvent> events;
+    std::vector<uint64_t> offsets;     // start of each event's records in `records`
+    std::vector<char> records;
+
+    size_t size() const { return events.size(); }
+    RecordSpan payload(size_t i) const {
+        return RecordSpan{records.data() + offsets[i], events[i].payload_size, events[i].record_count};
+    }
+};
+
+// Per-consumer backpressure accounting, cumulative since the consumer registered
+struct ConsumerCounters {
+    uint64_t dropped;
+    uint64_t conflated;
+    uint64_t stalls;
+    uint64_t stall_ns;
+};
+
+using TickEventRing = BroadcastRing<TickEvent, RING_SIZE, MAX_CONSUMERS>;
+
+struct SharedRingBuffer {
+    // Day sessions: day_started is also the futex emitters wait on for the next day, and
+    // ack_seq the one the generator waits on for their acknowledgements
+    alignas(64) std::atomic<uint32_t> day_started;
+    std::atomic<uint32_t> day_finished;
+    std::atomic<uint32_t> ack_seq;
+
+    std::atomic<uint64_t> total_generated;
+    std::atomic<uint64_t> dropped_count;
+    std::atomic<uint64_t> slab_head;                   // next free slab position, producer only
+    uint64_t cached_slab_tail;                         // producer's copy of the slowest slab tail
+
+    // slab_head as of the last publish: every event published after it has its records at
+    // or past this position, so a joining consumer starts its slab tail here
+    alignas(64) std::atomic<uint64_t> slab_published;
+
+    // Producer parking for futex consumers: set while the generator sleeps on wake_seq
+    alignas(64) std::atomic<uint32_t> producer_waiting;
+    std::atomic<uint32_t> wake_seq;
+
+    // Consumer parking: emitters that ran out of events sleep on publish_seq, counted in
+    // consumer_waiters so the producer only makes the wake syscall when someone sleeps
+    alignas(64) std::atomic<uint32_t> consumer_waiters;
+    std::atomic<uint32_t> publish_seq;
+
+    // Per-consumer state, indexed like the event cursors
+    struct alignas(64) ConsumerSlot {
+        std::atomic<uint64_t> slab_tail;               // slab position released so far
+        std::atomic<uint32_t> policy;
+        std::atomic<uint64_t> dropped;                 // events lapped by the producer
+        std::atomic<uint64_t> conflated;               // events skipped for a newer one
+        std::atomic<uint64_t> stalls;                  // producer waits this consumer held up
+        std::atomic<uint64_t> stall_ns;
+        std::atomic<uint32_t> acked_day;               // last day this consumer drained
+    };
+    ConsumerSlot consumers[MAX_CONSUMERS];
+
+    // Built in place over the mapped segment, which may hold a previous run: every field but
+    // the slab is set here
+    SharedRingBuffer() {
+        day_started.store(0, std::memory_order_relaxed);
+        day_finished.store(0, std::memory_order_relaxed);
+        ack_seq.store(0, std::memory_order_relaxed);
+        total_generated.store(0, std::memory_order_relaxed);
+        dropped_count.store(0, std::memory_order_relaxed);
+        producer_waiting.store(0, std::memory_order_relaxed);
+        wake_seq.store(0, std::memory_order_relaxed);
+        consumer_waiters.store(0, std::memory_order_relaxed);
+        publish_seq.store(0, std::memory_order_relaxed);
+        for (auto& c : consumers) {
+            c.policy.store(POLICY_DROP, std::memory_order_relaxed);
+            c.dropped.store(0, std::memory_order_relaxed);
+            c.conflated.store(0, std::memory_order_relaxed);
+            c.stalls.store(0, std::memory_order_relaxed);
+            c.stall_ns.store(0, std::memory_order_relaxed);
+            c.acked_day.store(0, std::memory_order_relaxed);
+        }
+        reset();
+    }
+
+    // Ring buffer data
+    TickEventRing events;
+    char slab[SLAB_SIZE];
+
+    // Producer: rewind a fresh segment; only safe while no consumer is reading or joining
+    void reset() {
+        events.reset();
+        slab_head.store(0, std::memory_order_relaxed);
+        slab_published.store(0, std::memory_order_relaxed);
+        cached_slab_tail = 0;
+        for (auto& c : consumers) c.slab_tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Consumer: join the ring; returns the cursor id or -1 if MAX_CONSUMERS are attached.
+    // Days that finished before it joined count as acknowledged. The day is read after the
+    // cursor is claimed, seq_cst like the claim, and finish() fences before wait_for_acks()
+    // scans the cursors: either the generator waits for this one, or it reads the last finish.
+    int register_consumer(BackpressurePolicy policy) {
+        // Read before the cursor joins, so the events from its head on lie at or past pos.
+        // pos may be far behind by the time the cursor is active; min_slab_tail() lifts it
+        // as soon as the cursor has caught up.
+        uint64_t pos = slab_published.load(std::memory_order_acquire);
+        int cursor = events.register_consumer(policy_blocks(policy), [&](size_t id) {
+            ConsumerSlot& c = consumers[id];
+            c.acked_day.store(day_finished.load(std::memory_order_seq_cst), std::memory_order_relaxed);
+            c.slab_tail.store(pos, std::memory_order_relaxed);
+            c.policy.store(policy, std::memory_order_relaxed);
+            c.dropped.store(0, std::memory_order_relaxed);
+            c.conflated.store(0, std::memory_order_relaxed);
+            c.stalls.store(0, std::memory_order_relaxed);
+            c.stall_ns.store(0, std::memory_order_relaxed);
+        });
+
+        // A generator waiting for acks held off while we joined; have it look again
+        if (cursor >= 0) {
+            ack_seq.fetch_add(1, std::memory_order_release);
+            futex_wake_all(&ack_seq);
+        }
+        return cursor;
+    }
+
+    void unregister_consumer(int id) {
+        events.unregister_consumer(id);
+    }
+
+    ConsumerCounters counters(size_t id) const {
+        const ConsumerSlot& c = consumers[id];
+        return ConsumerCounters{c.dropped.load(std::memory_order_relaxed),
+                                c.conflated.load(std::memory_order_relaxed),
+                                c.stalls.load(std::memory_order_relaxed),
+                                c.stall_ns.load(std::memory_order_relaxed)};
+    }
+
+    // Producer: slab position released by every blocking consumer. A joining one may hold a
+    // stale slab tail until it is active, so it counts as a full slab behind at most; the
+    // fence pairs with register_consumer as in TickEventRing::min_tail(). One that has
+    // released every published event holds no records: whatever it reads next lies at or
+    // past slab_published, however far behind its own slab tail is.
+    uint64_t min_slab_tail() const {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t head = slab_head.load(std::memory_order_relaxed);
+        uint64_t published = slab_published.load(std::memory_order_relaxed);
+        uint64_t slowest = head;
+        for (size_t i = 0; i < MAX_CONSUMERS; i++) {
+            if (!events.holds_back(i)) continue;
+            uint64_t tail = consumers[i].slab_tail.load(std::memory_order_acquire);
+            if (!events.active(i)) {
+                tail = std::max(tail, head > SLAB_SIZE ? head - SLAB_SIZE : 0);
+            } else if (events.caught_up(i)) {
+                tail = std::max(tail, published);
+            }
+            slowest = std::min(slowest, tail);
+        }
+        return slowest;
+    }
+
+    // Producer: where the records of the next event go; a bare tick carries it as its offset
+    uint64_t slab_position() const {
+        return slab_head.load(std::memory_order_relaxed);
+    }
+
+    // Producer: make committed events visible and wake parked consumers. The waiter check is
+    // a plain load on the hot path; a wake lost to store-load reordering is made up by the
+    // next publish or the park timeout.
+    void publish(size_t n = 1) {
+        events.commit(n);
+        slab_published.store(slab_head.load(std::memory_order_relaxed), std::memory_order_release);
+        wake_consumers(false);
+    }
+
+    // Producer: fenced=true when no publish may follow soon (end of day, producer stalled),
+    // so a consumer that parked just now is not left waiting for the timeout
+    void wake_consumers(bool fenced) {
+        if (fenced) std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_waiters.load(std::memory_order_relaxed)) {
+            publish_seq.fetch_add(1, std::memory_order_release);
+            futex_wake_all(&publish_seq);
+        }
+    }
+
+    // Producer: open day `day`. Call only after wait_for_acks(day - 1), so every consumer has
+    // drained the previous day and is parked in wait_for_day.
+    void start_day(uint32_t day) {
+        day_started.store(day, std::memory_order_release);
+        futex_wake_all(&day_started);
+    }
+
+    // Producer: flag the end of the day and wake everyone to see it. The fence in
+    // wake_consumers(true) also orders the store before wait_for_acks() scans the cursors.
+    void finish() {
+        day_finished.store(day_started.load(std::memory_order_relaxed), std::memory_order_release);
+        wake_consumers(true);
+    }
+
+    bool day_done() const {
+        return day_finished.load(std::memory_order_acquire) == day_started.load(std::memory_order_relaxed);
+    }
+
+    // Producer: wait until every attached consumer has acknowledged day `day`. A consumer
+    // that detaches no longer counts; one still joining is waited for until it has read
+    // which day it joined after. idle() runs between parks. Returns false if `running`
+    // went false first.
+    template <typename Idle>
+    bool wait_for_acks(uint32_t day, const volatile bool& running, Idle idle) {
+        auto all_acked = [&] {
+            for (size_t i = 0; i < MAX_CONSUMERS; i++) {
+                if (events.joining(i)) return false;
+                if (events.active(i) && consumers[i].acked_day.load(std::memory_order_acquire) < day) return false;
+            }
+            return true;
+        };
+        while (running) {
+            uint32_t seq = ack_seq.load(std::memory_order_acquire);
+            if (all_acked()) return true;
+            idle();
+            futex_wait(&ack_seq, seq, PRODUCER_PARK_NS);
+        }
+        return false;
+    }
+
+    // Consumer: the day its next session is, following the last one it acknowledged
+    uint32_t next_day(int id) const {
+        return consumers[id].acked_day.load(std::memory_order_relaxed) + 1;
+    }
+
+    // Consumer: park until the generator opens day `day`. Returns false if `running` went
+    // false first.
+    bool wait_for_day(uint32_t day, const volatile bool& running) {
+        for (;;) {
+            uint32_t started = day_started.load(std::memory_order_acquire);
+            if (started >= day) return true;
+            if (!running) return false;
+            futex_wait(&day_started, started, CONSUMER_PARK_NS);
+        }
+    }
+
+    // Consumer: done with day `day`; the generator opens the next one once everyone has said so
+    void ack_day(int id, uint32_t day) {
+        consumers[id].acked_day.store(day, std::memory_order_release);
+        ack_seq.fetch_add(1, std::memory_order_release);
+        futex_wake_all(&ack_seq);
+    }
+
+    // Consumer: true once this cursor has events to read or the producer has finished
+    bool has_work(int id) const {
+        return events.published() != events.tail(id) || day_done();
+    }
+
+    // Consumer: wait for has_work(id). Spins for spin_ns first, so a busy stream sees no
+    // futex traffic, yielding now and then in case the producer shares our CPU; then parks
+    // on publish_seq. Returns the number of times it parked.
+    uint64_t wait_for_events(int id, uint64_t spin_ns, const volatile bool& running) {
+        auto spin_until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(spin_ns);
+        for (uint32_t i = 1; !has_work(id); i++) {
+            if (!running) return 0;
+            cpu_relax();
+            if ((i & 63) == 0) {
+                if (std::chrono::steady_clock::now() >= spin_until) break;
+                sched_yield();
+            }
+        }
+
+        uint64_t parks = 0;
+        while (running && !has_work(id)) {
+            uint32_t seq = publish_seq.load(std::memory_order_acquire);
+            consumer_waiters.fetch_add(1, std::memory_order_seq_cst);
+            if (!has_work(id)) {
+                futex_wait(&publish_seq, seq, CONSUMER_PARK_NS);
+                parks++;
+            }
+            consumer_waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        return parks;
+    }
+
+    // Producer: wait until ready(), spinning while only spin consumers hold the ring back and
+    // parking on wake_seq once a futex one does. The stall is charged to every consumer for
+    // which blocking(id) held when it began. Returns false if `running` went false first.
+    template <typename Ready, typename Blocking>
+    bool wait_for_consumers(Ready ready, Blocking blocking, const volatile bool& running) {
+        bool blockers[MAX_CONSUMERS] = {};
+        bool park = false;
+        for (size_t i = 0; i < MAX_CONSUMERS; i++) {
+            if (events.active(i) && events.gating(i) && blocking(i)) {
+                blockers[i] = true;
+                park |= consumers[i].policy.load(std::memory_order_relaxed) == POLICY_FUTEX;
+            }
+        }
+
+        // A blocking consumer may be parked on a wake the last publish missed
+        wake_consumers(true);
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok;
+        while (!(ok = ready()) && running) {
+            if (park) {
+                uint32_t seq = wake_seq.load(std::memory_order_acquire);
+                producer_waiting.store(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!ready()) futex_wait(&wake_seq, seq, PRODUCER_PARK_NS);
+                producer_waiting.store(0, std::memory_order_relaxed);
+            } else {
+                cpu_relax();
+            }
+        }
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        for (size_t i = 0; i < MAX_CONSUMERS; i++) {
+            if (!blockers[i]) continue;
+            consumers[i].stalls.fetch_add(1, std::memory_order_relaxed);
+            consumers[i].stall_ns.fetch_add(ns, std::memory_order_relaxed);
+        }
+        return ok;
+    }
+
+    // Producer: one event slot, waiting out blocking consumers that are a full ring behind.
+    // count is 0 only when `running` went false while waiting.
+    TickEventRing::Span claim_event(const volatile bool& running) {
+        auto slot = events.claim();
+        if (slot.count) return slot;
+
+        uint64_t head = events.head.load(std::memory_order_relaxed);
+        wait_for_consumers([&] { return (slot = events.claim()).count != 0; },
+                           [&](size_t id) { return head - events.tail(id) >= RING_SIZE; },
+                           running);
+        return slot;
+    }
+
+    // Producer: place `size` bytes of records in the slab, contiguous even across the wrap,
+    // waiting out blocking consumers that have not released enough of it. Fails only when
+    // `running` went false while waiting, or the records could never fit.
+    bool slab_write(const char* data, size_t size, uint64_t& offset, const volatile bool& running) {
+        if (size > SLAB_SIZE) return false;
+        uint64_t pos = slab_head.load(std::memory_order_relaxed);
+        size_t idx = pos & SLAB_MASK;
+        if (idx + size > SLAB_SIZE) pos += SLAB_SIZE - idx;
+        uint64_t end = pos + size;
+        if (end - cached_slab_tail > SLAB_SIZE) {
+            cached_slab_tail = min_slab_tail();
+            if (end - cached_slab_tail > SLAB_SIZE &&
+                !wait_for_consumers(
+                    [&] { return end - (cached_slab_tail = min_slab_tail()) <= SLAB_SIZE; },
+                    [&](size_t id) { return end - consumers[id].slab_tail.load(std::memory_order_acquire) > SLAB_SIZE; },
+                    running)) {
+                return false;
+            }
+        }
+
+        // Reserve before copying, so a lossy reader that sees the new bytes also sees the
+        // reservation that overwrote its records
+        slab_head.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&slab[pos & SLAB_MASK], data, size);
+        offset = pos;
+        return true;
+    }
+
+    // Consumer: records carried by an event; valid until its span is released
+    RecordSpan payload(const TickEvent& e) const {
+        return RecordSpan{&slab[e.payload_offset & SLAB_MASK], e.payload_size, e.record_count};
+    }
+
+    // Consumer: hand a span of read events back to the producer, slab bytes first, and wake
+    // the producer if it is parked on this futex consumer. Bare ticks carry the slab head,
+    // so the slab tail follows the last event whether it had records or not.
+    void release(int id, const TickEventRing::Span& span) {
+        ConsumerSlot& c = consumers[id];
+        if (span.count) {
+            const TickEvent& last = span.data[span.count - 1];
+            c.slab_tail.store(last.payload_offset + last.payload_size, std::memory_order_release);
+        }
+        events.release(id, span.count);
+
+        if (c.policy.load(std::memory_order_relaxed) == POLICY_FUTEX) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (producer_waiting.load(std::memory_order_relaxed)) {
+                wake_seq.fetch_add(1, std::memory_order_release);
+                futex_wake_all(&wake_seq);
+            }
+        }
+    }
+
+    // Consumer on a lossy cursor (drop, conflate): the producer never waits for it and may
+    // overwrite events and records it has not read, so up to `max` of them are copied into
+    // `out` first and then checked against how far the producer got meanwhile, seqlock style.
+    // Lapped events are skipped and counted as dropped; a conflating cursor skips straight
+    // to the newest pending event. Returns the number of events copied.
+    size_t read_copy(int id, EventCopy& out, size_t max) {
+        ConsumerSlot& c = consumers[id];
+        out.events.clear();
+        out.offsets.clear();
+        out.records.clear();
+
+        uint64_t tail = events.tail(id);
+        uint64_t head = events.published();
+        if (head == tail) return 0;
+        if (c.policy.load(std::memory_order_relaxed) == POLICY_CONFLATE && head - tail > 1) {
+            c.conflated.store(c.conflated.load(std::memory_order_relaxed) + (head - 1 - tail), std::memory_order_relaxed);
+            tail = head - 1;
+        }
+        if (head - tail > RING_SIZE) {
+            c.dropped.store(c.dropped.load(std::memory_order_relaxed) + (head - RING_SIZE - tail), std::memory_order_relaxed);
+            tail = head - RING_SIZE;
+        }
+        size_t n = static_cast<size_t>(std::min<uint64_t>(head - tail, max));
+
+        for (size_t i = 0; i < n; i++) {
+            const TickEvent& e = events.at(tail + i);
+            out.events.push_back(e);
+            out.offsets.push_back(out.records.size());
+            // A lapped slot may be torn; only copy records that lie inside the slab
+            size_t idx = e.payload_offset & SLAB_MASK;
+            if (e.payload_size && idx + e.payload_size <= SLAB_SIZE) {
+                out.records.insert(out.records.end(), &slab[idx], &slab[idx] + e.payload_size);
+            }
+        }
+
+        // Anything the producer overwrote while we copied is older than what it did not
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t head_now = events.published();
+        uint64_t slab_now = slab_head.load(std::memory_order_relaxed);
+        size_t skip = n;
+        while (skip > 0) {
+            const TickEvent& e = out.events[skip - 1];
+            bool lapped = tail + skip - 1 + RING_SIZE <= head_now ||
+                          (e.payload_size && e.payload_offset + SLAB_SIZE < slab_now);
+            if (lapped) break;
+            skip--;
+        }
+        if (skip) {
+            out.events.erase(out.events.begin(), out.events.begin() + skip);
+            out.offsets.erase(out.offsets.begin(), out.offsets.begin() + skip);
+            c.dropped.store(c.dropped.load(std::memory_order_relaxed) + skip, std::memory_order_relaxed);
+        }
+
+        events.seek(id, tail + n);
+        return out.size();
+    }
+};
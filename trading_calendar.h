@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "civil_date.h"
+
+// Exchange trading days: Monday to Friday, minus the holidays loaded from a text file with one
+// YYYY-MM-DD date per line. Anything after the date is a description; blank lines and lines
+// starting with '#' are skipped. The generator, the emitters and the replayer iterate days
+// through the same calendar, so they skip the same days and stay in step.
+class TradingCalendar {
+public:
+    bool load(const std::string& path, std::string& error) {
+        std::ifstream in(path);
+        if (!in) {
+            error = "unable to open holiday file " + path;
+            return false;
+        }
+        std::vector<int64_t> days;
+        std::string line;
+        for (size_t n = 1; std::getline(in, line); n++) {
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#') continue;
+            int y = 0;
+            unsigned m = 0, d = 0;
+            if (std::sscanf(line.c_str() + start, "%d-%u-%u", &y, &m, &d) != 3 || !valid_civil(y, m, d)) {
+                error = path + ":" + std::to_string(n) + ": expected a YYYY-MM-DD date";
+                return false;
+            }
+            days.push_back(days_from_civil(y, m, d));
+        }
+        std::sort(days.begin(), days.end());
+        days.erase(std::unique(days.begin(), days.end()), days.end());
+        holidays_.swap(days);
+        return true;
+    }
+
+    static bool is_weekend(int64_t days) {
+        unsigned wd = weekday_from_days(days);
+        return wd == 0 || wd == 6;
+    }
+
+    bool is_holiday(int64_t days) const {
+        return std::binary_search(holidays_.begin(), holidays_.end(), days);
+    }
+
+    bool is_trading_day(int64_t days) const {
+        return !is_weekend(days) && !is_holiday(days);
+    }
+
+    bool is_trading_day(int y, unsigned m, unsigned d) const {
+        return is_trading_day(days_from_civil(y, m, d));
+    }
+
+    // First trading day on or after `days` (days since 1970-01-01)
+    int64_t next_trading_day(int64_t days) const {
+        while (!is_trading_day(days)) days++;
+        return days;
+    }
+
+    size_t holidays() const { return holidays_.size(); }
+
+private:
+    std::vector<int64_t> holidays_;     // sorted days since 1970-01-01
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+// Collects consecutive datagrams and hands them to the kernel with one sendmmsg() call.
+// Payloads are referenced, not copied: they must stay valid until the next flush().
+// A batch is flushed when it holds max_batch datagrams or when its oldest datagram has
+// waited max_delay, so batching never adds more than max_delay of latency.
+// A datagram added with a non-zero gso_size is segmented by the kernel (UDP_SEGMENT).
+class UdpBatchSender {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t batches = 0;          // sendmmsg() calls that sent at least one datagram
+        uint64_t datagrams = 0;        // datagrams (GSO buffers count once) accepted by the kernel
+        uint64_t failed = 0;           // datagrams dropped because sendmmsg() failed
+        uint64_t max_batch = 0;        // largest batch flushed
+    };
+
+    UdpBatchSender(int sock, const sockaddr_in& dest, size_t max_batch, Clock::duration max_delay)
+        : sock_(sock), dest_(dest), max_batch_(max_batch ? max_batch : 1), max_delay_(max_delay),
+          iov_(max_batch_), msgs_(max_batch_), gso_(max_batch_), cmsg_(max_batch_) {}
+
+    // Queue one datagram; flushes if the batch is full or its deadline has passed
+    void add(const void* data, size_t len, Clock::time_point now = Clock::now(), uint16_t gso_size = 0) {
+        if (pending_ == 0) deadline_ = now + max_delay_;
+
+        iov_[pending_].iov_base = const_cast<void*>(data);
+        iov_[pending_].iov_len = len;
+        gso_[pending_] = gso_size;
+        pending_++;
+
+        if (pending_ == max_batch_ || now >= deadline_) flush();
+    }
+
+    // Flush if the oldest queued datagram has reached its deadline
+    void poll(Clock::time_point now = Clock::now()) {
+        if (pending_ && now >= deadline_) flush();
+    }
+
+    void flush() {
+        for (size_t i = 0; i < pending_; i++) {
+            msghdr& hdr = msgs_[i].msg_hdr;
+            hdr = msghdr{};
+            hdr.msg_name = &dest_;
+            hdr.msg_namelen = sizeof(dest_);
+            hdr.msg_iov = &iov_[i];
+            hdr.msg_iovlen = 1;
+#ifdef UDP_SEGMENT
+            if (gso_[i]) {
+                hdr.msg_control = cmsg_[i].buf;
+                hdr.msg_controllen = sizeof(cmsg_[i].buf);
+                cmsghdr* cm = CMSG_FIRSTHDR(&hdr);
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                *reinterpret_cast<uint16_t*>(CMSG_DATA(cm)) = gso_[i];
+            }
+#endif
+        }
+
+        size_t done = 0;
+        while (done < pending_) {
+            int n = sendmmsg(sock_, &msgs_[done], static_cast<unsigned>(pending_ - done), 0);
+            if (n <= 0) {
+                // The failing datagram is dropped; keep going with the rest of the batch
+                stats_.failed++;
+                done++;
+                continue;
+            }
+            stats_.batches++;
+            stats_.datagrams += n;
+            done += n;
+        }
+        if (pending_ > stats_.max_batch) stats_.max_batch = pending_;
+        pending_ = 0;
+    }
+
+    // Send what is queued to the old destination, then switch
+    void set_dest(const sockaddr_in& dest) {
+        flush();
+        dest_ = dest;
+    }
+
+    size_t pending() const { return pending_; }
+    Clock::time_point deadline() const { return deadline_; }
+    const Stats& stats() const { return stats_; }
+    void reset_stats() { stats_ = Stats{}; }
+
+private:
+    struct GsoControl {
+        alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(uint16_t))];
+    };
+
+    int sock_;
+    sockaddr_in dest_;
+    size_t max_batch_;
+    Clock::duration max_delay_;
+    std::vector<iovec> iov_;
+    std::vector<mmsghdr> msgs_;
+    std::vector<uint16_t> gso_;
+    std::vector<GsoControl> cmsg_;
+    size_t pending_ = 0;
+    Clock::time_point deadline_{};
+    Stats stats_;
+};